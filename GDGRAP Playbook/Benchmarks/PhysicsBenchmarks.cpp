@@ -0,0 +1,461 @@
+/*
+ * Physics Microbenchmarks
+ *
+ * Times the engine's hot paths at sizes from 10 up to 1M elements and prints the results
+ * as JSON (default) or CSV so runs can be compared by scripts.
+ *
+ * usage: physics_benchmarks [--filter substring] [--max-n N] [--min-time ms] [--csv]
+ *
+ * Each case builds its fixture for one size, then runs it repeatedly until min-time has
+ * elapsed. Cases that consume their input (contact resolution) restore it between runs,
+ * outside the timed region.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Physics/ContactArena.h"
+#include "../Physics/ContactResolver.h"
+#include "../Physics/DragForceGenerator.h"
+#include "../Physics/ForceRegistry.h"
+#include "../Physics/GravityForceGenerator.h"
+#include "../Physics/MyVector.h"
+#include "../Physics/MyVector4.h"
+#include "../Physics/ParticleIntegrator.h"
+#include "../Physics/PhysicsParticle.h"
+#include "../Physics/Rod.h"
+#include "../Physics/SpatialHash.h"
+#include "../Physics/SpringSet.h"
+#include "../Physics/Springs/AnchoredSpring.h"
+#include "../Physics/Springs/Bungee.h"
+#include "../Physics/Springs/Chain.h"
+#include "../Physics/Springs/ParticleSpring.h"
+
+namespace
+{
+	struct Fixture
+	{
+		std::function<void()> Run;
+		std::function<void()> Reset; // Optional, untimed
+	};
+
+	struct Case
+	{
+		std::string Name;
+		unsigned int MaxN;
+		std::function<Fixture(unsigned int n)> Setup;
+	};
+
+	struct Result
+	{
+		std::string Name;
+		unsigned int N;
+		unsigned long long Iterations;
+		double MeanNs;
+		double MinNs;
+	};
+
+	// Prevents the optimiser from discarding benchmark results
+	volatile float sink;
+
+	std::vector<MyVector> RandomVectors(unsigned int n, unsigned int seed, float extent)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> coordinate(-extent, extent);
+
+		std::vector<MyVector> vectors(n);
+		for (MyVector& v : vectors) v = MyVector(coordinate(random), coordinate(random), coordinate(random));
+		return vectors;
+	}
+
+	// Particles bound to a store, scattered over a cube of half-size extent
+	struct ParticleSet
+	{
+		ParticleStore Store;
+		std::vector<PhysicsParticle> Particles;
+
+		ParticleSet(unsigned int n, float extent, float radius = 0)
+		{
+			std::vector<MyVector> positions = RandomVectors(n, 1, extent);
+			std::vector<MyVector> velocities = RandomVectors(n, 2, 5.0f);
+
+			Particles.resize(n);
+			for (unsigned int i = 0; i < n; i++)
+			{
+				Particles[i].Position() = positions[i];
+				Particles[i].Velocity() = velocities[i];
+				Particles[i].SetMass(2.0f);
+				Particles[i].SetDamping(0.9f);
+				Particles[i].SetRadius(radius);
+				Particles[i].Bind(&Store);
+			}
+		}
+	};
+
+	Fixture VectorCase(unsigned int n, const std::function<void(std::vector<MyVector>&, const std::vector<MyVector>&)>& op)
+	{
+		auto a = std::make_shared<std::vector<MyVector>>(RandomVectors(n, 1, 10.0f));
+		auto b = std::make_shared<std::vector<MyVector>>(RandomVectors(n, 2, 10.0f));
+		return Fixture{ [a, b, op] { op(*a, *b); sink = (*a)[0].x; }, nullptr };
+	}
+
+	Fixture Vector4Case(unsigned int n, const std::function<void(std::vector<MyVector4>&, const std::vector<MyVector4>&)>& op)
+	{
+		std::vector<MyVector> a = RandomVectors(n, 1, 10.0f);
+		std::vector<MyVector> b = RandomVectors(n, 2, 10.0f);
+		auto a4 = std::make_shared<std::vector<MyVector4>>(a.begin(), a.end());
+		auto b4 = std::make_shared<std::vector<MyVector4>>(b.begin(), b.end());
+		return Fixture{ [a4, b4, op] { op(*a4, *b4); sink = (*a4)[0].x; }, nullptr };
+	}
+
+	Fixture SpringCase(unsigned int n, const std::function<ForceGenerator*(ParticleSet&, unsigned int)>& make)
+	{
+		auto set = std::make_shared<ParticleSet>(n, 100.0f);
+		auto springs = std::make_shared<std::vector<std::unique_ptr<ForceGenerator>>>();
+		for (unsigned int i = 0; i < n; i++) springs->emplace_back(make(*set, i));
+
+		return Fixture{
+			[set, springs]
+			{
+				for (unsigned int i = 0; i < set->Particles.size(); i++)
+					(*springs)[i]->UpdateForce(&set->Particles[i], 0.01f);
+			},
+			[set] { for (MyVector& f : set->Store.AccumulatedForces) f = MyVector(0, 0, 0); }
+		};
+	}
+
+	Fixture LinkCase(unsigned int n, const std::function<ParticleLink*(ParticleSet&, unsigned int)>& make)
+	{
+		auto set = std::make_shared<ParticleSet>(n, 100.0f);
+		auto links = std::make_shared<std::vector<std::unique_ptr<ParticleLink>>>();
+		for (unsigned int i = 0; i < n; i++) links->emplace_back(make(*set, i));
+		auto arena = std::make_shared<ContactArena>();
+
+		return Fixture{
+			[set, links, arena]
+			{
+				arena->Reset();
+				for (auto& link : *links) link->GetContact(*arena);
+				sink = static_cast<float>(arena->Size());
+			},
+			nullptr
+		};
+	}
+
+	std::vector<Case> MakeCases()
+	{
+		std::vector<Case> cases;
+		const unsigned int million = 1000000;
+
+		cases.push_back({ "MyVector/Add", million, [](unsigned int n)
+		{
+			return VectorCase(n, [](std::vector<MyVector>& a, const std::vector<MyVector>& b)
+			{
+				for (size_t i = 0; i < a.size(); i++) a[i] = a[i] + b[i];
+			});
+		} });
+		cases.push_back({ "MyVector/Scale", million, [](unsigned int n)
+		{
+			return VectorCase(n, [](std::vector<MyVector>& a, const std::vector<MyVector>&)
+			{
+				for (MyVector& v : a) v = v * 0.999f;
+			});
+		} });
+		cases.push_back({ "MyVector/ScalarProduct", million, [](unsigned int n)
+		{
+			return VectorCase(n, [](std::vector<MyVector>& a, const std::vector<MyVector>& b)
+			{
+				float sum = 0;
+				for (size_t i = 0; i < a.size(); i++) sum += a[i].ScalarProduct(b[i]);
+				sink = sum;
+			});
+		} });
+		cases.push_back({ "MyVector/VectorProduct", million, [](unsigned int n)
+		{
+			return VectorCase(n, [](std::vector<MyVector>& a, const std::vector<MyVector>& b)
+			{
+				for (size_t i = 0; i < a.size(); i++) a[i] = a[i].VectorProduct(b[i]).normalize() * 10.0f;
+			});
+		} });
+		cases.push_back({ "MyVector/Normalize", million, [](unsigned int n)
+		{
+			return VectorCase(n, [](std::vector<MyVector>& a, const std::vector<MyVector>& b)
+			{
+				for (size_t i = 0; i < a.size(); i++) a[i] = b[i].normalize();
+			});
+		} });
+		cases.push_back({ "MyVector/FastDirection", million, [](unsigned int n)
+		{
+			return VectorCase(n, [](std::vector<MyVector>& a, const std::vector<MyVector>& b)
+			{
+				for (size_t i = 0; i < a.size(); i++) a[i] = b[i].FastDirection();
+			});
+		} });
+		cases.push_back({ "MyVector/AddScaled", million, [](unsigned int n)
+		{
+			return VectorCase(n, [](std::vector<MyVector>& a, const std::vector<MyVector>& b)
+			{
+				for (size_t i = 0; i < a.size(); i++) a[i].AddScaled(b[i], 0.001f);
+			});
+		} });
+
+		cases.push_back({ "MyVector4/Add", million, [](unsigned int n)
+		{
+			return Vector4Case(n, [](std::vector<MyVector4>& a, const std::vector<MyVector4>& b)
+			{
+				for (size_t i = 0; i < a.size(); i++) a[i] = a[i] + b[i];
+			});
+		} });
+		cases.push_back({ "MyVector4/VectorProduct", million, [](unsigned int n)
+		{
+			return Vector4Case(n, [](std::vector<MyVector4>& a, const std::vector<MyVector4>& b)
+			{
+				for (size_t i = 0; i < a.size(); i++) a[i] = a[i].VectorProduct(b[i]).Direction() * 10.0f;
+			});
+		} });
+		cases.push_back({ "MyVector4/Normalize", million, [](unsigned int n)
+		{
+			return Vector4Case(n, [](std::vector<MyVector4>& a, const std::vector<MyVector4>& b)
+			{
+				for (size_t i = 0; i < a.size(); i++) a[i] = b[i].Direction();
+			});
+		} });
+
+		cases.push_back({ "PhysicsParticle/Update", million, [](unsigned int n)
+		{
+			auto set = std::make_shared<ParticleSet>(n, 100.0f);
+			return Fixture{ [set] { for (PhysicsParticle& p : set->Particles) p.Update(0.01f); }, nullptr };
+		} });
+
+		const char* kernelNames[] = { "Scalar", "SSE", "AVX2" };
+		for (int kernel = ParticleIntegrator::Scalar; kernel <= ParticleIntegrator::BestAvailable(); kernel++)
+		{
+			cases.push_back({ std::string("ParticleIntegrator/") + kernelNames[kernel], million, [kernel](unsigned int n)
+			{
+				auto set = std::make_shared<ParticleSet>(n, 100.0f);
+				auto integrator = std::make_shared<ParticleIntegrator>();
+				integrator->SetKernel(static_cast<ParticleIntegrator::Kernel>(kernel));
+				return Fixture{ [set, integrator] { integrator->Integrate(set->Store, 0.01f); }, nullptr };
+			} });
+		}
+
+		cases.push_back({ "ForceRegistry/UpdateForces/GravityDrag", million, [](unsigned int n)
+		{
+			auto set = std::make_shared<ParticleSet>(n, 100.0f);
+			auto gravity = std::make_shared<GravityForceGenerator>(MyVector(0, -9.8f, 0));
+			auto drag = std::make_shared<DragForceGenerator>(0.1f, 0.01f);
+			auto registry = std::make_shared<ForceRegistry>();
+			for (PhysicsParticle& p : set->Particles)
+			{
+				registry->Add(&p, gravity.get());
+				registry->Add(&p, drag.get());
+			}
+			return Fixture{ [set, gravity, drag, registry] { registry->UpdateForces(0.01f); }, nullptr };
+		} });
+		cases.push_back({ "ForceRegistry/UpdateForces/Springs", million, [](unsigned int n)
+		{
+			auto set = std::make_shared<ParticleSet>(n, 100.0f);
+			auto springs = std::make_shared<std::vector<std::unique_ptr<ParticleSpring>>>();
+			auto registry = std::make_shared<ForceRegistry>();
+			for (unsigned int i = 0; i < n; i++)
+			{
+				springs->emplace_back(new ParticleSpring(&set->Particles[(i + 1) % n], 50.0f, 1.0f));
+				registry->Add(&set->Particles[i], springs->back().get());
+			}
+			return Fixture{ [set, springs, registry] { registry->UpdateForces(0.01f); }, nullptr };
+		} });
+
+		cases.push_back({ "Springs/AnchoredSpring", million, [](unsigned int n)
+		{
+			return SpringCase(n, [](ParticleSet&, unsigned int) -> ForceGenerator*
+			{
+				return new AnchoredSpring(MyVector(0, 0, 0), 50.0f, 10.0f);
+			});
+		} });
+		cases.push_back({ "Springs/ParticleSpring", million, [](unsigned int n)
+		{
+			return SpringCase(n, [n](ParticleSet& set, unsigned int i) -> ForceGenerator*
+			{
+				return new ParticleSpring(&set.Particles[(i + 1) % n], 50.0f, 1.0f);
+			});
+		} });
+		cases.push_back({ "Springs/Bungee", million, [](unsigned int n)
+		{
+			return SpringCase(n, [](ParticleSet&, unsigned int) -> ForceGenerator*
+			{
+				return new Bungee(MyVector(0, 0, 0), 50.0f, 10.0f);
+			});
+		} });
+
+		// Springs a ring of particles like ForceRegistry/UpdateForces/Springs, but pushing both ends
+		for (int kernel = ParticleIntegrator::Scalar; kernel <= ParticleIntegrator::BestAvailable(); kernel++)
+		{
+			cases.push_back({ std::string("SpringSet/UpdateForces/") + kernelNames[kernel], million, [kernel](unsigned int n)
+			{
+				auto set = std::make_shared<ParticleSet>(n, 100.0f);
+				auto springs = std::make_shared<SpringSet>();
+				springs->SetKernel(static_cast<ParticleIntegrator::Kernel>(kernel));
+				for (unsigned int i = 0; i < n; i++) springs->Add(&set->Particles[i], &set->Particles[(i + 1) % n], 50.0f, 1.0f);
+				return Fixture{
+					[set, springs] { springs->UpdateForces(set->Store); },
+					[set] { for (MyVector& f : set->Store.AccumulatedForces) f = MyVector(0, 0, 0); }
+				};
+			} });
+		}
+
+		cases.push_back({ "Links/Chain/GetContact", million, [](unsigned int n)
+		{
+			return LinkCase(n, [](ParticleSet& set, unsigned int i) -> ParticleLink*
+			{
+				// Roughly half of the chains are overstretched
+				return new Chain(&set.Particles[i], MyVector(0, 0, 0), 100.0f, 0.5f);
+			});
+		} });
+		cases.push_back({ "Links/Rod/GetContact", million, [](unsigned int n)
+		{
+			return LinkCase(n, [n](ParticleSet& set, unsigned int i) -> ParticleLink*
+			{
+				Rod* rod = new Rod();
+				rod->particles[0] = &set.Particles[i];
+				rod->particles[1] = &set.Particles[(i + 1) % n];
+				rod->length = 50.0f;
+				return rod;
+			});
+		} });
+
+		cases.push_back({ "ContactResolver/ResolveContacts", million, [](unsigned int n)
+		{
+			// n contacts between random neighbours, all closing and penetrating
+			auto set = std::make_shared<ParticleSet>(n < 2 ? 2 : n, 100.0f);
+			auto pristine = std::make_shared<std::vector<ParticleContact>>(n);
+			auto velocities = std::make_shared<std::vector<MyVector>>(set->Store.Velocities);
+			auto positions = std::make_shared<std::vector<MyVector>>(set->Store.Positions);
+			const unsigned int count = static_cast<unsigned int>(set->Particles.size());
+			for (unsigned int i = 0; i < n; i++)
+			{
+				ParticleContact& contact = (*pristine)[i];
+				contact.particles[0] = &set->Particles[i % count];
+				contact.particles[1] = &set->Particles[(i * 7 + 1) % count];
+				contact.contactNormal = (contact.particles[0]->Position() - contact.particles[1]->Position()).normalize();
+				contact.restitution = 0.5f;
+				contact.depth = 0.01f * (i % 10);
+			}
+
+			auto contacts = std::make_shared<std::vector<ParticleContact>>();
+			auto resolver = std::make_shared<ContactResolver>(100);
+			return Fixture{
+				[contacts, resolver, n] { resolver->ResolveContacts(contacts->data(), n, 0.01f); },
+				[set, pristine, contacts, velocities, positions]
+				{
+					*contacts = *pristine;
+					set->Store.Velocities = *velocities;
+					set->Store.Positions = *positions;
+				}
+			};
+		} });
+
+		cases.push_back({ "SpatialHash/FindOverlaps", million, [](unsigned int n)
+		{
+			// Density kept constant so the overlap count grows linearly with n
+			float extent = 2.0f * std::cbrt(static_cast<float>(n));
+			auto set = std::make_shared<ParticleSet>(n, extent, 0.5f);
+			auto hash = std::make_shared<SpatialHash>();
+			auto overlaps = std::make_shared<std::vector<SpatialHash::Overlap>>();
+			return Fixture{ [set, hash, overlaps] { hash->FindOverlaps(set->Store, *overlaps); }, nullptr };
+		} });
+
+		return cases;
+	}
+
+	Result Measure(const Case& benchmark, unsigned int n, double minTimeMs)
+	{
+		using clock = std::chrono::steady_clock;
+
+		Fixture fixture = benchmark.Setup(n);
+		if (fixture.Reset) fixture.Reset();
+		fixture.Run(); // Warm-up
+
+		Result result{ benchmark.Name, n, 0, 0, 1e300 };
+		double totalNs = 0;
+		while (totalNs < minTimeMs * 1e6 || result.Iterations < 3)
+		{
+			if (fixture.Reset) fixture.Reset();
+
+			auto before = clock::now();
+			fixture.Run();
+			double ns = std::chrono::duration<double, std::nano>(clock::now() - before).count();
+
+			totalNs += ns;
+			result.MinNs = std::min(result.MinNs, ns);
+			result.Iterations++;
+		}
+		result.MeanNs = totalNs / result.Iterations;
+		return result;
+	}
+
+	void PrintUsage()
+	{
+		std::fprintf(stderr, "usage: physics_benchmarks [--filter substring] [--max-n N] [--min-time ms] [--csv]\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string filter;
+	unsigned int maxN = 1000000;
+	double minTimeMs = 100.0;
+	bool csv = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--filter") == 0 && hasValue) filter = argv[++i];
+		else if (std::strcmp(argv[i], "--max-n") == 0 && hasValue) maxN = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--min-time") == 0 && hasValue) minTimeMs = std::strtod(argv[++i], nullptr);
+		else if (std::strcmp(argv[i], "--csv") == 0) csv = true;
+		else
+		{
+			PrintUsage();
+			return -1;
+		}
+	}
+
+	if (csv) std::printf("name,n,iterations,mean_ns,min_ns,ns_per_element\n");
+	else std::printf("{\n  \"benchmarks\": [");
+
+	bool first = true;
+	for (const Case& benchmark : MakeCases())
+	{
+		if (!filter.empty() && benchmark.Name.find(filter) == std::string::npos) continue;
+
+		for (unsigned int n = 10; n <= std::min(maxN, benchmark.MaxN); n *= 10)
+		{
+			Result r = Measure(benchmark, n, minTimeMs);
+			if (csv)
+			{
+				std::printf("%s,%u,%llu,%.1f,%.1f,%.3f\n", r.Name.c_str(), r.N, r.Iterations, r.MeanNs, r.MinNs,
+				            r.MeanNs / r.N);
+			}
+			else
+			{
+				std::printf("%s\n    {\"name\": \"%s\", \"n\": %u, \"iterations\": %llu, \"mean_ns\": %.1f, "
+				            "\"min_ns\": %.1f, \"ns_per_element\": %.3f}",
+				            first ? "" : ",", r.Name.c_str(), r.N, r.Iterations, r.MeanNs, r.MinNs, r.MeanNs / r.N);
+			}
+			std::fflush(stdout);
+			first = false;
+		}
+	}
+
+	if (!csv) std::printf("\n  ]\n}\n");
+	return 0;
+}
@@ -0,0 +1,200 @@
+/*
+ * Headless Runner
+ *
+ * Loads a scene file, steps a PhysicsWorld for a fixed number of frames at a fixed dt
+ * and prints timing statistics. No window or GL context is created, so it runs on
+ * build machines and servers. With --fixed-step each frame's dt goes through the world's
+ * fixed-step accumulator (PhysicsWorld::Advance) instead of being simulated directly.
+ * With --record the run is written to a replay file for replay_runner. --contacts picks the
+ * contact solver: most-severe (the default), colored or impulse (see ContactResolver).
+ * --position-based projects links instead (PhysicsWorld::PositionBased), usually together
+ * with a longer --max-substep. --implicit-springs solves springs with backward Euler
+ * (PhysicsWorld::ImplicitSprings), which also allows longer substeps. A run whose particles
+ * reach an infinite or NaN position or velocity stops with an error.
+ *
+ * usage: headless_runner <scene file> [--frames N] [--dt seconds] [--threads N] [--no-sleep]
+ *                       [--fixed-step seconds] [--record replay file]
+ *                       [--contacts most-severe|colored|impulse] [--max-substep seconds]
+ *                       [--position-based [iterations]] [--implicit-springs]
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Replay.h"
+
+namespace
+{
+	void PrintUsage()
+	{
+		std::cerr << "usage: headless_runner <scene file> [--frames N] [--dt seconds] [--threads N] [--no-sleep]"
+			" [--fixed-step seconds] [--record replay file] [--contacts most-severe|colored|impulse]"
+			" [--max-substep seconds] [--position-based [iterations]] [--implicit-springs]\n";
+	}
+
+	// False once any particle's position or velocity has become infinite or NaN
+	bool StateIsFinite(const ParticleStore& particles)
+	{
+		for (unsigned int i = 0; i < particles.Size(); i++)
+		{
+			const MyVector& p = particles.Positions[i];
+			const MyVector& v = particles.Velocities[i];
+			if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z) ||
+				!std::isfinite(v.x) || !std::isfinite(v.y) || !std::isfinite(v.z)) return false;
+		}
+		return true;
+	}
+
+	double Percentile(const std::vector<double>& sorted, double fraction)
+	{
+		size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+		return sorted[index];
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string scenePath;
+	unsigned int frames = 1000;
+	float dt = 1.0f / 60.0f;
+	unsigned int threads = 0;
+	bool sleep = true;
+	float fixedStep = 0.0f;
+	std::string recordPath;
+	ContactResolver::Mode contactMode = ContactResolver::MostSevereFirst;
+	bool validMode = true;
+	float maxSubstep = 0.01f;
+	bool positionBased = false;
+	unsigned int positionIterations = 10;
+	bool implicitSprings = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--frames") == 0 && hasValue) frames = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--dt") == 0 && hasValue) dt = std::strtof(argv[++i], nullptr);
+		else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) threads = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--no-sleep") == 0) sleep = false;
+		else if (std::strcmp(argv[i], "--fixed-step") == 0 && hasValue) fixedStep = std::strtof(argv[++i], nullptr);
+		else if (std::strcmp(argv[i], "--record") == 0 && hasValue) recordPath = argv[++i];
+		else if (std::strcmp(argv[i], "--contacts") == 0 && hasValue)
+		{
+			const std::string mode = argv[++i];
+			if (mode == "most-severe") contactMode = ContactResolver::MostSevereFirst;
+			else if (mode == "colored") contactMode = ContactResolver::Colored;
+			else if (mode == "impulse") contactMode = ContactResolver::SequentialImpulse;
+			else validMode = false;
+		}
+		else if (std::strcmp(argv[i], "--max-substep") == 0 && hasValue) maxSubstep = std::strtof(argv[++i], nullptr);
+		else if (std::strcmp(argv[i], "--position-based") == 0)
+		{
+			positionBased = true;
+			if (hasValue && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))) positionIterations = std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--implicit-springs") == 0) implicitSprings = true;
+		else if (argv[i][0] != '-' && scenePath.empty()) scenePath = argv[i];
+		else
+		{
+			PrintUsage();
+			return -1;
+		}
+	}
+
+	if (scenePath.empty() || frames == 0 || dt <= 0.0f || fixedStep < 0.0f || !validMode || maxSubstep <= 0.0f)
+	{
+		PrintUsage();
+		return -1;
+	}
+
+	SceneDescription description;
+	std::string error;
+	if (!description.Load(scenePath, error))
+	{
+		std::cerr << error << "\n";
+		return -1;
+	}
+
+	ReplaySettings settings;
+	settings.FixedStep = fixedStep;
+	settings.Sleep = sleep;
+	settings.ContactMode = contactMode;
+	settings.MaxSubstep = maxSubstep;
+	settings.PositionBased = positionBased;
+	settings.PositionIterations = positionIterations;
+	settings.ImplicitSprings = implicitSprings;
+
+	PhysicsWorld world;
+	world.Workers.SetThreadCount(threads);
+	settings.Apply(world);
+
+	Scene scene(description);
+	if (!scene.Build(world, error))
+	{
+		std::cerr << error << "\n";
+		return -1;
+	}
+
+	ReplayRecorder recorder;
+	if (!recordPath.empty() && !recorder.Open(recordPath, description, settings, error))
+	{
+		std::cerr << error << "\n";
+		return -1;
+	}
+
+	using clock = std::chrono::steady_clock;
+	std::vector<double> frameMs;
+	frameMs.reserve(frames);
+	unsigned long long contacts = 0;
+	unsigned long long steps = 0;
+
+	auto start = clock::now();
+	for (unsigned int frame = 0; frame < frames; frame++)
+	{
+		auto before = clock::now();
+		if (fixedStep > 0.0f) steps += world.Advance(dt);
+		else world.Update(dt);
+		auto after = clock::now();
+		recorder.RecordFrame(dt, scene);
+
+		frameMs.push_back(std::chrono::duration<double, std::milli>(after - before).count());
+		contacts += world.Contacts.Size();
+
+		if (!StateIsFinite(world.Particles))
+		{
+			std::cerr << "Simulation blew up: non-finite particle state after frame " << frame << "\n";
+			return -1;
+		}
+	}
+	double totalMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+	std::vector<double> sorted = frameMs;
+	std::sort(sorted.begin(), sorted.end());
+
+	std::cout << "scene      " << scenePath << " (" << description.Type << ")\n";
+	std::cout << "particles  " << world.Particles.Size() << "\n";
+	std::cout << "frames     " << frames << " x " << dt << " s (" << frames * dt << " s simulated)\n";
+	if (fixedStep > 0.0f) std::cout << "steps      " << steps << " x " << fixedStep << " s\n";
+	std::cout << "threads    " << threads << "\n";
+	std::cout << "asleep     " << world.Particles.Size() - world.Particles.AwakeIndices().size() << " particles in "
+		<< world.Islands.SleepingIslandCount() << " islands at the end\n";
+	if (implicitSprings) std::cout << "springs    " << world.SpringSolver.GetIterations() << " CG iterations in the last substep\n";
+	std::cout << "contacts   " << static_cast<double>(contacts) / frames << " per frame (last substep)";
+	if (contactMode == ContactResolver::Colored) std::cout << ", " << world.Resolver.GetColorCount() << " colors at the end";
+	std::cout << "\n";
+	std::cout << "total      " << totalMs << " ms (" << frames * dt * 1000.0 / totalMs << "x real time)\n";
+	std::cout << "frame ms   mean " << totalMs / frames
+		<< "  min " << sorted.front()
+		<< "  p50 " << Percentile(sorted, 0.50)
+		<< "  p95 " << Percentile(sorted, 0.95)
+		<< "  p99 " << Percentile(sorted, 0.99)
+		<< "  max " << sorted.back() << "\n";
+
+	return 0;
+}
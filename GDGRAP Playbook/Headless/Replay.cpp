@@ -0,0 +1,214 @@
+#include "Replay.h"
+
+#include <cstring>
+#include <sstream>
+
+namespace
+{
+	const char Magic[4] = { 'G', 'D', 'R', 'P' };
+	const unsigned int Version = 4;
+	// Larger sizes mean a damaged file
+	const unsigned int MaxSceneText = 1u << 16;
+	const unsigned int MaxKeyframeParticles = 1u << 24;
+
+	template <typename T>
+	void Put(std::ofstream& file, const T& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	bool Get(std::ifstream& file, T& value)
+	{
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+
+	void Mix(unsigned int& hash, float value)
+	{
+		unsigned int bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		hash = (hash ^ bits) * 16777619u;
+	}
+}
+
+void ReplaySettings::Apply(PhysicsWorld& world) const
+{
+	if (FixedStep > 0.0f) world.FixedStep = FixedStep;
+	world.MaxStepsPerFrame = MaxStepsPerFrame;
+	world.Islands.Enabled = Sleep;
+	world.Resolver.mode = ContactMode;
+	world.MaxSubstep = MaxSubstep;
+	world.PositionBased = PositionBased;
+	world.PositionIterations = PositionIterations;
+	world.ImplicitSprings = ImplicitSprings;
+}
+
+void ReplaySettings::Step(PhysicsWorld& world, float dt) const
+{
+	if (FixedStep > 0.0f) world.Advance(dt);
+	else world.Update(dt);
+}
+
+unsigned int ReplayChecksum(const Scene& scene)
+{
+	unsigned int hash = 2166136261u;
+	for (const PhysicsParticle& particle : scene.Particles)
+	{
+		const MyVector& position = particle.Position();
+		const MyVector& velocity = particle.Velocity();
+		Mix(hash, position.x);
+		Mix(hash, position.y);
+		Mix(hash, position.z);
+		Mix(hash, velocity.x);
+		Mix(hash, velocity.y);
+		Mix(hash, velocity.z);
+	}
+	return hash;
+}
+
+bool ReplayRecorder::Open(const std::string& path, const SceneDescription& scene, const ReplaySettings& settings, std::string& error)
+{
+	Close();
+	file.open(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		error = "cannot write replay file " + path;
+		return false;
+	}
+
+	std::ostringstream text;
+	scene.Save(text);
+	const std::string sceneText = text.str();
+
+	file.write(Magic, sizeof(Magic));
+	Put(file, Version);
+	Put(file, settings.FixedStep);
+	Put(file, settings.MaxStepsPerFrame);
+	Put(file, static_cast<unsigned char>(settings.Sleep ? 1 : 0));
+	Put(file, static_cast<unsigned char>(settings.ContactMode));
+	Put(file, settings.MaxSubstep);
+	Put(file, static_cast<unsigned char>(settings.PositionBased ? 1 : 0));
+	Put(file, settings.PositionIterations);
+	Put(file, static_cast<unsigned char>(settings.ImplicitSprings ? 1 : 0));
+	Put(file, static_cast<unsigned int>(sceneText.size()));
+	file.write(sceneText.data(), sceneText.size());
+	file.flush();
+
+	frames = 0;
+	return true;
+}
+
+void ReplayRecorder::Close()
+{
+	if (file.is_open()) file.close();
+}
+
+void ReplayRecorder::RecordForce(unsigned int particle, const MyVector& force)
+{
+	if (!file.is_open()) return;
+
+	Put(file, static_cast<unsigned char>(ReplayRecord::Force));
+	Put(file, particle);
+	Put(file, force);
+}
+
+void ReplayRecorder::RecordFrame(float dt, const Scene& scene)
+{
+	if (!file.is_open()) return;
+
+	Put(file, static_cast<unsigned char>(ReplayRecord::Frame));
+	Put(file, dt);
+	Put(file, ReplayChecksum(scene));
+	frames++;
+
+	if (KeyframeInterval > 0 && frames % KeyframeInterval == 0)
+	{
+		Put(file, static_cast<unsigned char>(ReplayRecord::Keyframe));
+		Put(file, static_cast<unsigned int>(scene.Particles.size()));
+		for (const PhysicsParticle& particle : scene.Particles) Put(file, particle.Position());
+
+		// Whatever was recorded up to here survives a crash
+		file.flush();
+	}
+}
+
+bool ReplayReader::Open(const std::string& path, SceneDescription& scene, ReplaySettings& settings, std::string& error)
+{
+	file.open(path, std::ios::binary);
+	if (!file)
+	{
+		error = "cannot open replay file " + path;
+		return false;
+	}
+
+	char magic[4];
+	unsigned int version = 0;
+	unsigned char sleep = 1;
+	unsigned char contactMode = 0;
+	unsigned char positionBased = 0;
+	unsigned char implicitSprings = 0;
+	unsigned int sceneSize = 0;
+	bool ok = file.read(magic, sizeof(magic)) && std::memcmp(magic, Magic, sizeof(Magic)) == 0
+		&& Get(file, version) && version == Version
+		&& Get(file, settings.FixedStep) && Get(file, settings.MaxStepsPerFrame) && Get(file, sleep)
+		&& Get(file, contactMode) && contactMode <= ContactResolver::SequentialImpulse
+		&& Get(file, settings.MaxSubstep) && Get(file, positionBased) && Get(file, settings.PositionIterations)
+		&& Get(file, implicitSprings)
+		&& Get(file, sceneSize) && sceneSize <= MaxSceneText;
+	if (!ok)
+	{
+		error = path + ": not a replay file of this version";
+		return false;
+	}
+	settings.Sleep = sleep != 0;
+	settings.ContactMode = static_cast<ContactResolver::Mode>(contactMode);
+	settings.PositionBased = positionBased != 0;
+	settings.ImplicitSprings = implicitSprings != 0;
+
+	std::string sceneText(sceneSize, '\0');
+	if (!file.read(&sceneText[0], sceneSize))
+	{
+		error = path + ": truncated scene";
+		return false;
+	}
+
+	std::istringstream text(sceneText);
+	return scene.Parse(text, path, error);
+}
+
+bool ReplayReader::Next(ReplayRecord& record)
+{
+	unsigned char type;
+	if (!Get(file, type)) return false;
+
+	bool ok;
+	switch (type)
+	{
+	case ReplayRecord::Frame:
+		record.Type = ReplayRecord::Frame;
+		ok = Get(file, record.Dt) && Get(file, record.Checksum);
+		break;
+	case ReplayRecord::Force:
+		record.Type = ReplayRecord::Force;
+		ok = Get(file, record.Particle) && Get(file, record.Value);
+		break;
+	case ReplayRecord::Keyframe:
+	{
+		record.Type = ReplayRecord::Keyframe;
+		unsigned int count = 0;
+		ok = Get(file, count) && count <= MaxKeyframeParticles;
+		if (ok)
+		{
+			record.Positions.resize(count);
+			ok = count == 0 || file.read(reinterpret_cast<char*>(record.Positions.data()), count * sizeof(MyVector));
+		}
+		break;
+	}
+	default:
+		ok = false;
+		break;
+	}
+
+	if (!ok) truncated = true;
+	return ok;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Scene.h"
+
+// Replay files record a run so it can be simulated again offline.
+// A file starts with the stepping settings and the scene description, followed by a stream
+// of records written as the run goes: external forces, and for every frame its dt and a
+// checksum of the resulting state, plus every KeyframeInterval frames the positions of all
+// scene particles. Rebuilding the scene and feeding it the same records reproduces the run
+// bit for bit, so any checksum mismatch on replay means the simulation code has changed.
+
+// How the recorded world was stepped each frame
+struct ReplaySettings
+{
+	float FixedStep = 0.0f; // 0 for PhysicsWorld::Update(dt), otherwise Advance(dt) with this step
+	int MaxStepsPerFrame = 8;
+	bool Sleep = true; // IslandManager::Enabled
+	ContactResolver::Mode ContactMode = ContactResolver::MostSevereFirst;
+	float MaxSubstep = 0.01f; // PhysicsWorld::MaxSubstep
+	bool PositionBased = false; // PhysicsWorld::PositionBased
+	unsigned int PositionIterations = 10;
+	bool ImplicitSprings = false; // PhysicsWorld::ImplicitSprings
+
+	void Apply(PhysicsWorld& world) const;
+	void Step(PhysicsWorld& world, float dt) const;
+};
+
+// Hash of the position and velocity bits of every scene particle
+unsigned int ReplayChecksum(const Scene& scene);
+
+class ReplayRecorder
+{
+public:
+	// Frames between position keyframes; 0 records checksums only
+	unsigned int KeyframeInterval = 60;
+
+	bool Open(const std::string& path, const SceneDescription& scene, const ReplaySettings& settings, std::string& error);
+	bool IsOpen() const { return file.is_open(); }
+	void Close();
+
+	// A force added to scene particle index, which takes effect at the next step
+	void RecordForce(unsigned int particle, const MyVector& force);
+	// Call after stepping the world through dt
+	void RecordFrame(float dt, const Scene& scene);
+
+private:
+	std::ofstream file;
+	unsigned int frames = 0;
+};
+
+struct ReplayRecord
+{
+	enum Kind
+	{
+		Frame = 1,
+		Force = 2,
+		Keyframe = 3
+	};
+	Kind Type = Frame;
+
+	float Dt = 0; // Frame
+	unsigned int Checksum = 0; // Frame
+
+	unsigned int Particle = 0; // Force
+	MyVector Value; // Force
+
+	std::vector<MyVector> Positions; // Keyframe, by scene particle
+};
+
+class ReplayReader
+{
+public:
+	bool Open(const std::string& path, SceneDescription& scene, ReplaySettings& settings, std::string& error);
+
+	// False at the end of the records. A record cut short, as left by a crashed run, ends
+	// the stream and sets Truncated.
+	bool Next(ReplayRecord& record);
+	bool Truncated() const { return truncated; }
+
+private:
+	std::ifstream file;
+	bool truncated = false;
+};
@@ -0,0 +1,169 @@
+/*
+ * Replay Runner
+ *
+ * Rebuilds the scene stored in a replay file, feeds it the recorded forces and frame
+ * times as fast as it can, and reports per-frame timing and where the state diverges
+ * from the recording. Exits with 2 when it diverges, so it can gate solver changes.
+ *
+ * usage: replay_runner <replay file> [--threads N] [--frames-csv path]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Replay.h"
+
+namespace
+{
+	void PrintUsage()
+	{
+		std::cerr << "usage: replay_runner <replay file> [--threads N] [--frames-csv path]\n";
+	}
+
+	double Percentile(const std::vector<double>& sorted, double fraction)
+	{
+		size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+		return sorted[index];
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string replayPath, csvPath;
+	unsigned int threads = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--threads") == 0 && hasValue) threads = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--frames-csv") == 0 && hasValue) csvPath = argv[++i];
+		else if (argv[i][0] != '-' && replayPath.empty()) replayPath = argv[i];
+		else
+		{
+			PrintUsage();
+			return -1;
+		}
+	}
+
+	if (replayPath.empty())
+	{
+		PrintUsage();
+		return -1;
+	}
+
+	SceneDescription description;
+	ReplaySettings settings;
+	ReplayReader reader;
+	std::string error;
+	if (!reader.Open(replayPath, description, settings, error))
+	{
+		std::cerr << error << "\n";
+		return -1;
+	}
+
+	PhysicsWorld world;
+	world.Workers.SetThreadCount(threads);
+	settings.Apply(world);
+
+	Scene scene(description);
+	if (!scene.Build(world, error))
+	{
+		std::cerr << error << "\n";
+		return -1;
+	}
+
+	using clock = std::chrono::steady_clock;
+	std::vector<double> frameMs;
+	std::vector<unsigned char> frameDiverged;
+	double simulated = 0;
+	unsigned int forces = 0, keyframes = 0;
+	float maxDeviation = 0;
+	unsigned int maxDeviationFrame = 0;
+
+	auto start = clock::now();
+	ReplayRecord record;
+	while (reader.Next(record))
+	{
+		switch (record.Type)
+		{
+		case ReplayRecord::Frame:
+		{
+			auto before = clock::now();
+			settings.Step(world, record.Dt);
+			frameMs.push_back(std::chrono::duration<double, std::milli>(clock::now() - before).count());
+
+			frameDiverged.push_back(ReplayChecksum(scene) != record.Checksum ? 1 : 0);
+			simulated += record.Dt;
+			break;
+		}
+		case ReplayRecord::Force:
+			if (record.Particle < scene.Particles.size()) scene.Particles[record.Particle].AddForce(record.Value);
+			forces++;
+			break;
+		case ReplayRecord::Keyframe:
+			keyframes++;
+			for (size_t i = 0; i < record.Positions.size() && i < scene.Particles.size(); i++)
+			{
+				MyVector offset = scene.Particles[i].Position() - record.Positions[i];
+				float deviation = offset.Magnitude();
+				// NaN counts as the largest deviation
+				if (!(deviation <= maxDeviation))
+				{
+					maxDeviation = deviation;
+					maxDeviationFrame = static_cast<unsigned int>(frameMs.size());
+				}
+			}
+			break;
+		}
+	}
+	double totalMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+	if (!csvPath.empty())
+	{
+		std::ofstream csv(csvPath);
+		csv << "frame,ms,diverged\n";
+		for (size_t i = 0; i < frameMs.size(); i++) csv << i + 1 << "," << frameMs[i] << "," << int(frameDiverged[i]) << "\n";
+	}
+
+	const unsigned int frames = static_cast<unsigned int>(frameMs.size());
+	const auto firstDiverged = std::find(frameDiverged.begin(), frameDiverged.end(), 1);
+	const size_t diverged = std::count(frameDiverged.begin(), frameDiverged.end(), 1);
+
+	std::cout << "replay     " << replayPath << (reader.Truncated() ? " (cut short)" : "") << "\n";
+	std::cout << "scene      " << description.Type << ", " << world.Particles.Size() << " particles\n";
+	if (settings.FixedStep > 0.0f) std::cout << "stepping   fixed " << settings.FixedStep << " s, at most " << settings.MaxStepsPerFrame << " per frame\n";
+	else std::cout << "stepping   frame dt in substeps of at most " << settings.MaxSubstep << " s\n";
+	const char* contactModes[] = { "most severe first", "colored batches", "sequential impulse" };
+	std::cout << "contacts   " << contactModes[settings.ContactMode] << "\n";
+	if (settings.ImplicitSprings) std::cout << "springs    implicit\n";
+	if (settings.PositionBased) std::cout << "links      position based, " << settings.PositionIterations << " iterations\n";
+	std::cout << "frames     " << frames << " (" << simulated << " s simulated), " << forces << " forces\n";
+	if (frames == 0) return 0;
+
+	std::vector<double> sorted = frameMs;
+	std::sort(sorted.begin(), sorted.end());
+	std::cout << "total      " << totalMs << " ms (" << simulated * 1000.0 / totalMs << "x real time)\n";
+	std::cout << "frame ms   mean " << totalMs / frames
+		<< "  min " << sorted.front()
+		<< "  p50 " << Percentile(sorted, 0.50)
+		<< "  p95 " << Percentile(sorted, 0.95)
+		<< "  p99 " << Percentile(sorted, 0.99)
+		<< "  max " << sorted.back() << "\n";
+
+	if (diverged == 0)
+	{
+		std::cout << "divergence none (" << keyframes << " keyframes, every checksum matches)\n";
+		return 0;
+	}
+	std::cout << "divergence " << diverged << " of " << frames << " frames, first at frame "
+		<< (firstDiverged - frameDiverged.begin()) + 1 << "; largest keyframe deviation "
+		<< maxDeviation << " at frame " << maxDeviationFrame << "\n";
+	return 2;
+}
@@ -0,0 +1,225 @@
+#include "Scene.h"
+
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <random>
+#include <sstream>
+
+#include "../Physics/Springs/AnchoredSpring.h"
+#include "../Physics/Springs/Chain.h"
+#include "../Physics/Springs/ParticleSpring.h"
+#include "../Physics/Rod.h"
+
+bool SceneDescription::Load(const std::string& path, std::string& error)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		error = "cannot open scene file " + path;
+		return false;
+	}
+	return Parse(file, path, error);
+}
+
+bool SceneDescription::Parse(std::istream& in, const std::string& name, std::string& error)
+{
+	std::string line;
+	unsigned int lineNumber = 0;
+	while (std::getline(in, line))
+	{
+		lineNumber++;
+		std::string::size_type comment = line.find('#');
+		if (comment != std::string::npos) line.erase(comment);
+
+		std::istringstream values(line);
+		std::string key;
+		if (!(values >> key)) continue;
+
+		bool ok;
+		if (key == "type") ok = static_cast<bool>(values >> Type);
+		else if (key == "springs") ok = static_cast<bool>(values >> Springs);
+		else if (key == "count") ok = static_cast<bool>(values >> Count);
+		else if (key == "radius") ok = static_cast<bool>(values >> Radius);
+		else if (key == "mass") ok = static_cast<bool>(values >> Mass);
+		else if (key == "cable_length") ok = static_cast<bool>(values >> CableLength);
+		else if (key == "gravity") ok = static_cast<bool>(values >> Gravity);
+		else if (key == "force") ok = static_cast<bool>(values >> Force.x >> Force.y >> Force.z);
+		else if (key == "restitution") ok = static_cast<bool>(values >> Restitution);
+		else if (key == "extent") ok = static_cast<bool>(values >> Extent);
+		else if (key == "stiffness") ok = static_cast<bool>(values >> Stiffness);
+		else if (key == "rest_length") ok = static_cast<bool>(values >> RestLength);
+		else if (key == "seed") ok = static_cast<bool>(values >> Seed);
+		else
+		{
+			error = name + ":" + std::to_string(lineNumber) + ": unknown key '" + key + "'";
+			return false;
+		}
+
+		if (!ok)
+		{
+			error = name + ":" + std::to_string(lineNumber) + ": bad value for '" + key + "'";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void SceneDescription::Save(std::ostream& out) const
+{
+	// Nine significant digits read back as the same float
+	std::ios::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision(9);
+
+	out << "type " << Type << "\n";
+	out << "springs " << Springs << "\n";
+	out << "count " << Count << "\n";
+	out << "radius " << Radius << "\n";
+	out << "mass " << Mass << "\n";
+	out << "cable_length " << CableLength << "\n";
+	out << "gravity " << Gravity << "\n";
+	out << "force " << Force.x << " " << Force.y << " " << Force.z << "\n";
+	out << "restitution " << Restitution << "\n";
+	out << "extent " << Extent << "\n";
+	out << "stiffness " << Stiffness << "\n";
+	out << "rest_length " << RestLength << "\n";
+	out << "seed " << Seed << "\n";
+
+	out.precision(precision);
+	out.flags(flags);
+}
+
+bool Scene::Build(PhysicsWorld& world, std::string& error)
+{
+	if (!Particles.empty())
+	{
+		error = "scene already built";
+		return false;
+	}
+
+	if (Description.Springs != "generators" && Description.Springs != "set")
+	{
+		error = "unknown springs '" + Description.Springs + "', expected generators or set";
+		return false;
+	}
+
+	world.SetGravity(MyVector(0, Description.Gravity, 0));
+	world.CollisionRestitution = Description.Restitution;
+
+	if (Description.Type == "cradle") BuildCradle(world);
+	else if (Description.Type == "cloud") BuildCloud(world);
+	else if (Description.Type == "rope") BuildRope(world);
+	else if (Description.Type == "chain") BuildChain(world);
+	else
+	{
+		error = "unknown scene type '" + Description.Type + "'";
+		return false;
+	}
+
+	if (!Particles.empty()) Particles[0].AddForce(Description.Force);
+	return true;
+}
+
+void Scene::BuildCradle(PhysicsWorld& world)
+{
+	const unsigned int count = Description.Count;
+	const float gap = 2.0f * Description.Radius;
+	const float startX = -(count - 1) * gap / 2.0f;
+
+	Particles.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		MyVector anchor(startX + i * gap, 0, 0);
+
+		PhysicsParticle& ball = Particles[i];
+		ball.Position() = anchor; // Start at anchor
+		ball.SetMass(Description.Mass);
+		ball.SetRadius(Description.Radius);
+		world.AddParticle(&ball);
+
+		Links.emplace_back(new Chain(&ball, anchor, Description.CableLength, 0.0f));
+		world.AddLink(Links.back().get());
+	}
+}
+
+void Scene::BuildCloud(PhysicsWorld& world)
+{
+	std::mt19937 random(Description.Seed);
+	std::uniform_real_distribution<float> coordinate(-Description.Extent, Description.Extent);
+
+	Particles.resize(Description.Count);
+	for (PhysicsParticle& particle : Particles)
+	{
+		particle.Position() = MyVector(coordinate(random), coordinate(random), coordinate(random));
+		particle.SetMass(Description.Mass);
+		particle.SetRadius(Description.Radius);
+		world.AddParticle(&particle);
+	}
+}
+
+void Scene::BuildRope(PhysicsWorld& world)
+{
+	Particles.resize(Description.Count);
+	for (unsigned int i = 0; i < Particles.size(); i++)
+	{
+		Particles[i].Position() = MyVector(i * Description.RestLength, 0, 0);
+		Particles[i].SetMass(Description.Mass);
+		world.AddParticle(&Particles[i]);
+	}
+
+	if (Particles.empty()) return;
+
+	if (Description.Springs == "set")
+	{
+		SpringSets.emplace_back(new SpringSet());
+		SpringSet& springs = *SpringSets.back();
+		springs.AddAnchored(&Particles[0], MyVector(0, 0, 0), Description.Stiffness, 0.0f);
+		for (unsigned int i = 0; i + 1 < Particles.size(); i++)
+		{
+			springs.Add(&Particles[i], &Particles[i + 1], Description.Stiffness, Description.RestLength);
+		}
+		world.SpringSets.push_back(&springs);
+		return;
+	}
+
+	Generators.emplace_back(new AnchoredSpring(MyVector(0, 0, 0), Description.Stiffness, 0.0f));
+	world.forceRegistry.Add(&Particles[0], Generators.back().get());
+
+	// A ParticleSpring only pushes the particle it is registered with, so each segment needs two
+	for (unsigned int i = 0; i + 1 < Particles.size(); i++)
+	{
+		Generators.emplace_back(new ParticleSpring(&Particles[i + 1], Description.Stiffness, Description.RestLength));
+		world.forceRegistry.Add(&Particles[i], Generators.back().get());
+
+		Generators.emplace_back(new ParticleSpring(&Particles[i], Description.Stiffness, Description.RestLength));
+		world.forceRegistry.Add(&Particles[i + 1], Generators.back().get());
+	}
+}
+
+void Scene::BuildChain(PhysicsWorld& world)
+{
+	Particles.resize(Description.Count);
+	for (unsigned int i = 0; i < Particles.size(); i++)
+	{
+		Particles[i].Position() = MyVector((i + 1) * Description.RestLength, 0, 0);
+		Particles[i].SetMass(Description.Mass);
+		Particles[i].SetRadius(Description.Radius);
+		world.AddParticle(&Particles[i]);
+	}
+
+	if (Particles.empty()) return;
+
+	Links.emplace_back(new Chain(&Particles[0], MyVector(0, 0, 0), Description.RestLength, 0.0f));
+	world.AddLink(Links.back().get());
+
+	for (unsigned int i = 0; i + 1 < Particles.size(); i++)
+	{
+		Rod* rod = new Rod();
+		rod->particles[0] = &Particles[i];
+		rod->particles[1] = &Particles[i + 1];
+		rod->length = Description.RestLength;
+		Links.emplace_back(rod);
+		world.AddLink(rod);
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../Physics/PhysicsWorld.h"
+#include "../Physics/ForceGenerator.h"
+#include "../Physics/ParticleLink.h"
+#include "../Physics/SpringSet.h"
+
+// Parameters of a scene, read from a text file of "key value..." lines ('#' starts a comment).
+struct SceneDescription
+{
+	// cradle: Newton's cradle of Count balls hanging from chains, like main.cpp
+	// cloud:  Count free colliding particles scattered in a cube of half-size Extent
+	// rope:   Count particles joined by springs, the first one anchored at the origin
+	// chain:  Count particles joined by rods RestLength long, the first one hanging from a
+	//         chain at the origin, released straight out to the side
+	std::string Type = "cradle";
+	// How a rope's springs are built: "generators", a ParticleSpring per segment end, or
+	// "set", one SpringSet holding every segment once
+	std::string Springs = "generators";
+
+	unsigned int Count = 5;
+	float Radius = 20.0f;
+	float Mass = 50.0f;
+	float CableLength = 200.0f;
+	float Gravity = -9.8f;
+	MyVector Force = MyVector(-20000.0f, 0, 0); // Applied to the first particle before the first frame
+	float Restitution = 0.9f;
+	float Extent = 100.0f;
+	float Stiffness = 50.0f;
+	float RestLength = 10.0f;
+	unsigned int Seed = 1;
+
+	bool Load(const std::string& path, std::string& error);
+	// Reads "key value..." lines from in; name prefixes error messages
+	bool Parse(std::istream& in, const std::string& name, std::string& error);
+	// Writes every parameter in the format Parse reads, exactly enough to rebuild the scene
+	void Save(std::ostream& out) const;
+};
+
+// Owns everything a scene adds to a PhysicsWorld
+class Scene
+{
+public:
+	explicit Scene(const SceneDescription& description) : Description(description) {}
+	Scene(const Scene&) = delete;
+	Scene& operator=(const Scene&) = delete;
+
+	const SceneDescription Description;
+
+	// Sized once in Build; never resized afterwards so the particles' addresses stay put
+	std::vector<PhysicsParticle> Particles;
+	std::vector<std::unique_ptr<ParticleLink>> Links;
+	std::vector<std::unique_ptr<ForceGenerator>> Generators;
+	std::vector<std::unique_ptr<SpringSet>> SpringSets;
+
+	bool Build(PhysicsWorld& world, std::string& error);
+
+private:
+	void BuildCradle(PhysicsWorld& world);
+	void BuildCloud(PhysicsWorld& world);
+	void BuildRope(PhysicsWorld& world);
+	void BuildChain(PhysicsWorld& world);
+};
@@ -0,0 +1,60 @@
+#include "LineBatch.h"
+
+#include <cstddef>
+
+LineBatch::~LineBatch()
+{
+	if (VAO) glDeleteVertexArrays(1, &VAO);
+	if (VBO) glDeleteBuffers(1, &VBO);
+}
+
+void LineBatch::Add(const glm::vec3& a, const glm::vec3& b, const glm::vec3& colorA, const glm::vec3& colorB)
+{
+	vertices.push_back(Vertex{ a, colorA });
+	vertices.push_back(Vertex{ b, colorB });
+}
+
+void LineBatch::Flush(ShaderProgram& shader, const glm::mat4& viewProjection)
+{
+	if (vertices.empty()) return;
+
+	if (!VAO)
+	{
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, position)));
+		glEnableVertexAttribArray(5);
+		glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, color)));
+
+		capacity = 256;
+	}
+	else
+	{
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	}
+
+	const GLsizeiptr count = static_cast<GLsizeiptr>(vertices.size());
+	while (capacity < count) capacity *= 2;
+
+	// Orphan last frame's storage so the upload does not wait for draws still reading it
+	glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Vertex), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(Vertex), vertices.data());
+
+	shader.Use();
+	shader.Set(shader.Uniform(ShaderProgram::MVP), viewProjection);
+	shader.Set(shader.Uniform(ShaderProgram::VertexColor), 1);
+
+	glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(count));
+
+	shader.Set(shader.Uniform(ShaderProgram::VertexColor), 0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	vertices.clear();
+}
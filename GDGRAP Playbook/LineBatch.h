@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ShaderProgram.h"
+
+// Collects the line segments of a frame (cables, rods, springs) and draws them all with
+// a single glDrawArrays call. The vertex buffer is created once and orphaned on every
+// Flush, so no GL objects are created or destroyed per segment or per frame.
+// Needs the per-vertex color input of Shaders/sample.vert (location 5).
+class LineBatch
+{
+public:
+	LineBatch() = default;
+	LineBatch(const LineBatch&) = delete;
+	LineBatch& operator=(const LineBatch&) = delete;
+	~LineBatch();
+
+	void Add(const glm::vec3& a, const glm::vec3& b, const glm::vec3& color) { Add(a, b, color, color); }
+	void Add(const glm::vec3& a, const glm::vec3& b, const glm::vec3& colorA, const glm::vec3& colorB);
+
+	// Draws everything added since the last Flush and empties the batch
+	void Flush(ShaderProgram& shader, const glm::mat4& viewProjection);
+
+private:
+	struct Vertex
+	{
+		glm::vec3 position;
+		glm::vec3 color;
+	};
+
+	std::vector<Vertex> vertices;
+
+	GLuint VAO = 0, VBO = 0;
+	GLsizeiptr capacity = 0; // Vertices the buffer has room for
+};
@@ -0,0 +1,343 @@
+#include "MeshCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char Magic[4] = { 'G', 'D', 'M', 'C' };
+	const uint32_t Version = 3; // Bumped whenever the importer output or the header changes
+
+	// Coarsest modification time a file system keeps (FAT), in nanoseconds
+	const int64_t TimeResolution = 2000000000;
+
+	struct Header
+	{
+		char Magic[4];
+		uint32_t Version;
+		uint32_t Attributes;
+		uint32_t VertexCount;
+		uint32_t IndexCount;
+		uint32_t ShapeCount;
+		float BoundsMin[3];
+		float BoundsMax[3];
+		uint64_t SourceSize;
+		int64_t SourceTime; // Nanoseconds since 1970
+		uint64_t SourceHash;
+	};
+	static_assert(sizeof(Header) == 72, "The cache header is read straight from the file");
+
+	struct SourceInfo
+	{
+		uint64_t Size;
+		int64_t Time;
+	};
+
+#ifdef _WIN32
+	int64_t Nanoseconds(const FILETIME& time)
+	{
+		// FILETIME counts 100 ns ticks since 1601
+		const int64_t ticks = static_cast<int64_t>((static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime);
+		return (ticks - 116444736000000000ll) * 100;
+	}
+#else
+	int64_t ModifiedTime(const struct stat& status)
+	{
+#ifdef __APPLE__
+		const timespec& time = status.st_mtimespec;
+#else
+		const timespec& time = status.st_mtim;
+#endif
+		return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+	}
+#endif
+
+	bool Stat(const std::string& path, SourceInfo& info)
+	{
+#ifdef _WIN32
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes)) return false;
+
+		info.Size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+		info.Time = Nanoseconds(attributes.ftLastWriteTime);
+#else
+		struct stat status;
+		if (stat(path.c_str(), &status) != 0) return false;
+
+		info.Size = static_cast<uint64_t>(status.st_size);
+		info.Time = ModifiedTime(status);
+#endif
+		return true;
+	}
+
+	// 64-bit FNV-1a of the whole file
+	bool Hash(const std::string& path, uint64_t& hash)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file) return false;
+
+		hash = 14695981039346656037ull;
+		char buffer[1 << 16];
+		while (file)
+		{
+			file.read(buffer, sizeof(buffer));
+			for (std::streamsize i = 0; i < file.gcount(); i++)
+			{
+				hash ^= static_cast<unsigned char>(buffer[i]);
+				hash *= 1099511628211ull;
+			}
+		}
+		return true;
+	}
+
+	size_t FileSize(const Header& header)
+	{
+		return sizeof(Header)
+			+ header.ShapeCount * sizeof(MeshShape)
+			+ static_cast<size_t>(header.VertexCount) * MeshView::VertexStride(header.Attributes) * sizeof(float)
+			+ header.IndexCount * sizeof(uint32_t);
+	}
+}
+
+unsigned int MeshView::VertexStride(uint32_t attributes)
+{
+	unsigned int stride = 0;
+	if (attributes & MeshData::Position) stride += 3;
+	if (attributes & MeshData::Normal) stride += 3;
+	if (attributes & MeshData::TexCoord) stride += 2;
+	return stride;
+}
+
+MeshView MeshData::View() const
+{
+	MeshView view;
+	view.Attributes = Attributes;
+	view.Vertices = Vertices.data();
+	view.Indices = Indices.data();
+	view.Shapes = Shapes.data();
+	view.IndexCount = static_cast<uint32_t>(Indices.size());
+	view.ShapeCount = static_cast<uint32_t>(Shapes.size());
+
+	const unsigned int stride = MeshView::VertexStride(Attributes);
+	view.VertexCount = stride ? static_cast<uint32_t>(Vertices.size() / stride) : 0;
+
+	// Positions come first in each vertex
+	if ((Attributes & Position) && view.VertexCount > 0)
+	{
+		for (int k = 0; k < 3; k++) view.BoundsMin[k] = view.BoundsMax[k] = Vertices[k];
+		for (uint32_t v = 1; v < view.VertexCount; v++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				float value = Vertices[v * stride + k];
+				if (value < view.BoundsMin[k]) view.BoundsMin[k] = value;
+				if (value > view.BoundsMax[k]) view.BoundsMax[k] = value;
+			}
+		}
+	}
+	return view;
+}
+
+MeshCache::~MeshCache()
+{
+	Close();
+}
+
+bool MeshCache::Open(const std::string& sourcePath)
+{
+	Close();
+
+	SourceInfo source;
+	if (!Stat(sourcePath, source)) return false;
+
+	const std::string path = CachePath(sourcePath);
+#ifdef _WIN32
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		file = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	FILETIME written;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(Header))
+		|| !GetFileTime(file, nullptr, nullptr, &written))
+	{
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		Close();
+		return false;
+	}
+
+	data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	size = static_cast<size_t>(fileSize.QuadPart);
+	const int64_t cacheTime = Nanoseconds(written);
+#else
+	int descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) return false;
+
+	struct stat status;
+	if (fstat(descriptor, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(Header)))
+	{
+		close(descriptor);
+		return false;
+	}
+
+	void* mapped = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+	close(descriptor); // The mapping keeps the file alive
+	if (mapped == MAP_FAILED) return false;
+
+	data = static_cast<const unsigned char*>(mapped);
+	size = static_cast<size_t>(status.st_size);
+	const int64_t cacheTime = ModifiedTime(status);
+#endif
+	if (!data)
+	{
+		Close();
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, data, sizeof(Header));
+
+	bool valid = std::memcmp(header.Magic, Magic, sizeof(Magic)) == 0
+		&& header.Version == Version
+		&& (header.Attributes & MeshData::Position)
+		&& FileSize(header) == size
+		&& header.SourceSize == source.Size;
+
+	// A copied or checked out source gets a new time but keeps its content. A source modified
+	// shortly before its cache was written may have been edited again within the file
+	// system's time resolution, so then the content decides too.
+	if (valid && (header.SourceTime != source.Time || cacheTime - header.SourceTime < TimeResolution))
+	{
+		uint64_t hash;
+		valid = Hash(sourcePath, hash) && hash == header.SourceHash;
+	}
+	if (!valid)
+	{
+		Close();
+		return false;
+	}
+
+	view.Attributes = header.Attributes;
+	view.VertexCount = header.VertexCount;
+	view.IndexCount = header.IndexCount;
+	view.ShapeCount = header.ShapeCount;
+	std::memcpy(view.BoundsMin, header.BoundsMin, sizeof(view.BoundsMin));
+	std::memcpy(view.BoundsMax, header.BoundsMax, sizeof(view.BoundsMax));
+
+	// Every section is a multiple of 4 bytes long, so each one stays aligned for its type
+	const unsigned char* cursor = data + sizeof(Header);
+	view.Shapes = reinterpret_cast<const MeshShape*>(cursor);
+	cursor += header.ShapeCount * sizeof(MeshShape);
+	view.Vertices = reinterpret_cast<const float*>(cursor);
+	cursor += static_cast<size_t>(header.VertexCount) * MeshView::VertexStride(header.Attributes) * sizeof(float);
+	view.Indices = reinterpret_cast<const uint32_t*>(cursor);
+
+	// Never hand out ranges that would read past the buffers
+	for (uint32_t s = 0; s < view.ShapeCount && valid; s++)
+	{
+		valid = view.Shapes[s].FirstIndex <= view.IndexCount
+			&& view.Shapes[s].IndexCount <= view.IndexCount - view.Shapes[s].FirstIndex;
+	}
+	for (uint32_t i = 0; i < view.IndexCount && valid; i++)
+	{
+		valid = view.Indices[i] < view.VertexCount;
+	}
+	if (!valid)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MeshCache::Close()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+	mapping = nullptr;
+	file = nullptr;
+#else
+	if (data) munmap(const_cast<unsigned char*>(data), size);
+#endif
+	data = nullptr;
+	size = 0;
+	view = MeshView();
+}
+
+bool MeshCache::Write(const std::string& sourcePath, const MeshView& mesh, std::string& error)
+{
+	SourceInfo source;
+	Header header;
+	if (!Stat(sourcePath, source) || !Hash(sourcePath, header.SourceHash))
+	{
+		error = "Cannot read mesh source " + sourcePath;
+		return false;
+	}
+
+	std::memcpy(header.Magic, Magic, sizeof(Magic));
+	header.Version = Version;
+	header.Attributes = mesh.Attributes;
+	header.VertexCount = mesh.VertexCount;
+	header.IndexCount = mesh.IndexCount;
+	header.ShapeCount = mesh.ShapeCount;
+	std::memcpy(header.BoundsMin, mesh.BoundsMin, sizeof(header.BoundsMin));
+	std::memcpy(header.BoundsMax, mesh.BoundsMax, sizeof(header.BoundsMax));
+	header.SourceSize = source.Size;
+	header.SourceTime = source.Time;
+
+	// Written aside and renamed into place so a reader never maps a half-written file
+	const std::string path = CachePath(sourcePath);
+	const std::string temporary = path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			error = "Cannot write mesh cache " + temporary;
+			return false;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(mesh.Shapes), mesh.ShapeCount * sizeof(MeshShape));
+		file.write(reinterpret_cast<const char*>(mesh.Vertices),
+		           static_cast<std::streamsize>(mesh.VertexCount) * MeshView::VertexStride(mesh.Attributes) * sizeof(float));
+		file.write(reinterpret_cast<const char*>(mesh.Indices), mesh.IndexCount * sizeof(uint32_t));
+		if (!file)
+		{
+			error = "Cannot write mesh cache " + temporary;
+			std::remove(temporary.c_str());
+			return false;
+		}
+	}
+
+	std::remove(path.c_str()); // rename does not replace existing files on Windows
+	if (std::rename(temporary.c_str(), path.c_str()) != 0)
+	{
+		error = "Cannot replace mesh cache " + path;
+		std::remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
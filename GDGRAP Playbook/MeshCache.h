@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A range of indices drawn as one part of a mesh
+struct MeshShape
+{
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+};
+
+// Read-only view of mesh geometry, as it is uploaded to the GPU
+struct MeshView
+{
+	uint32_t Attributes = 0; // MeshData::Attribute flags present in each vertex, in that order
+	uint32_t VertexCount = 0;
+	uint32_t IndexCount = 0;
+	uint32_t ShapeCount = 0;
+	const float* Vertices = nullptr; // Interleaved, VertexStride floats per vertex
+	const uint32_t* Indices = nullptr;
+	const MeshShape* Shapes = nullptr;
+	float BoundsMin[3] = { 0, 0, 0 };
+	float BoundsMax[3] = { 0, 0, 0 };
+
+	static unsigned int VertexStride(uint32_t attributes);
+};
+
+// Mesh geometry owned in memory, filled by an importer
+struct MeshData
+{
+	enum Attribute
+	{
+		Position = 1, // 3 floats
+		Normal = 2, // 3 floats
+		TexCoord = 4 // 2 floats
+	};
+
+	uint32_t Attributes = Position;
+	std::vector<float> Vertices;
+	std::vector<uint32_t> Indices;
+	std::vector<MeshShape> Shapes;
+
+	// Bounds are computed from the vertex positions
+	MeshView View() const;
+};
+
+// Binary cache of an imported mesh, stored next to its source as <source>.meshcache.
+// The file holds a header, the shape ranges, the interleaved vertices and the indices,
+// laid out so they can be used straight from a memory mapping. A cache is only used while
+// its source keeps the size and modification time (or, failing that, the content hash)
+// it was written from. Times are compared to the nanosecond; sources modified within two
+// seconds of their cache being written are always checked by content, as coarser file
+// systems cannot tell such edits apart by time.
+class MeshCache
+{
+public:
+	MeshCache() = default;
+	MeshCache(const MeshCache&) = delete;
+	MeshCache& operator=(const MeshCache&) = delete;
+	~MeshCache();
+
+	static std::string CachePath(const std::string& sourcePath) { return sourcePath + ".meshcache"; }
+
+	// Maps the cache of sourcePath. Returns false when there is none or it is out of date.
+	bool Open(const std::string& sourcePath);
+	void Close();
+
+	// Valid until Close or destruction
+	const MeshView& View() const { return view; }
+
+	// Writes mesh as the cache of sourcePath, replacing any older one
+	static bool Write(const std::string& sourcePath, const MeshView& mesh, std::string& error);
+
+private:
+	MeshView view;
+
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#endif
+};
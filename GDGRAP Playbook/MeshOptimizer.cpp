@@ -0,0 +1,214 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Typical post-transform cache size of current GPUs; larger sizes barely change the order
+	const int CacheSize = 32;
+
+	float VertexScore(int cachePosition, uint32_t remaining)
+	{
+		if (remaining == 0) return -1.0f; // Nothing left to draw with it
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// The last triangle's vertices get a fixed score so the next one does not just
+			// turn back on itself
+			if (cachePosition < 3) score = 0.75f;
+			else score = std::pow(1.0f - (cachePosition - 3) / float(CacheSize - 3), 1.5f);
+		}
+		// Favour vertices with few triangles left so they do not get stranded
+		return score + 2.0f / std::sqrt(float(remaining));
+	}
+
+	// Vertex shader runs for the given order with a FIFO cache of CacheSize entries
+	uint32_t CacheMisses(const uint32_t* indices, uint32_t indexCount, const std::vector<uint32_t>& localOf, uint32_t vertexCount)
+	{
+		std::vector<uint32_t> loadedAt(vertexCount, 0); // Miss count when the vertex last entered the cache, plus one
+		uint32_t misses = 0;
+		for (uint32_t i = 0; i < indexCount; i++)
+		{
+			uint32_t& loaded = loadedAt[localOf[indices[i]]];
+			if (loaded == 0 || misses - loaded >= CacheSize) loaded = ++misses;
+		}
+		return misses;
+	}
+
+	// Reorders the triangles of one shape. localOf maps vertices to shape-local ids and
+	// holds ~0u for every vertex on entry and exit.
+	void OptimizeRange(uint32_t* indices, uint32_t indexCount, std::vector<uint32_t>& localOf)
+	{
+		const uint32_t triangleCount = indexCount / 3;
+		if (triangleCount < 2) return;
+
+		// Work on densely numbered local vertices
+		std::vector<uint32_t> globalOf;
+		std::vector<uint32_t> local(triangleCount * 3);
+		for (uint32_t i = 0; i < triangleCount * 3; i++)
+		{
+			uint32_t& id = localOf[indices[i]];
+			if (id == ~0u)
+			{
+				id = static_cast<uint32_t>(globalOf.size());
+				globalOf.push_back(indices[i]);
+			}
+			local[i] = id;
+		}
+		const uint32_t vertexCount = static_cast<uint32_t>(globalOf.size());
+
+		// Triangles still to be drawn around each vertex: the first remaining[v] entries
+		// of adjacency from offsets[v]
+		std::vector<uint32_t> remaining(vertexCount, 0), offsets(vertexCount + 1, 0);
+		for (uint32_t v : local) remaining[v]++;
+		for (uint32_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + remaining[v];
+
+		std::vector<uint32_t> adjacency(local.size());
+		{
+			std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+			for (uint32_t i = 0; i < local.size(); i++) adjacency[cursor[local[i]]++] = i / 3;
+		}
+
+		std::vector<int> cachePosition(vertexCount, -1);
+		std::vector<float> score(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; v++) score[v] = VertexScore(-1, remaining[v]);
+
+		auto triangleScore = [&](uint32_t t) {
+			return score[local[t * 3]] + score[local[t * 3 + 1]] + score[local[t * 3 + 2]];
+		};
+
+		std::vector<char> emitted(triangleCount, 0);
+		std::vector<uint32_t> output;
+		output.reserve(triangleCount * 3);
+
+		int best = 0;
+		float bestScore = triangleScore(0);
+		for (uint32_t t = 1; t < triangleCount; t++)
+		{
+			float s = triangleScore(t);
+			if (s > bestScore)
+			{
+				best = static_cast<int>(t);
+				bestScore = s;
+			}
+		}
+
+		uint32_t cache[CacheSize + 3], next[CacheSize + 3];
+		int cacheCount = 0;
+		uint32_t scan = 0; // Every triangle before this one has been emitted
+
+		for (uint32_t drawn = 0; drawn < triangleCount; drawn++)
+		{
+			if (best < 0)
+			{
+				// Nothing in the cache has triangles left; continue from the next unused one
+				while (emitted[scan]) scan++;
+				best = static_cast<int>(scan);
+			}
+
+			const uint32_t t = static_cast<uint32_t>(best);
+			emitted[t] = 1;
+			for (int k = 0; k < 3; k++)
+			{
+				output.push_back(indices[t * 3 + k]);
+
+				// Take the triangle off its vertices' lists
+				uint32_t v = local[t * 3 + k];
+				uint32_t* list = &adjacency[offsets[v]];
+				for (uint32_t a = 0; a < remaining[v]; a++)
+				{
+					if (list[a] == t)
+					{
+						list[a] = list[--remaining[v]];
+						break;
+					}
+				}
+			}
+
+			// The triangle's vertices move to the front of the LRU cache
+			int nextCount = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t v = local[t * 3 + k];
+				bool present = false;
+				for (int c = 0; c < nextCount; c++) present |= next[c] == v;
+				if (!present) next[nextCount++] = v;
+			}
+			const int front = nextCount;
+			for (int c = 0; c < cacheCount; c++)
+			{
+				uint32_t v = cache[c];
+				bool present = false;
+				for (int f = 0; f < front; f++) present |= next[f] == v;
+				if (!present) next[nextCount++] = v;
+			}
+
+			for (int c = 0; c < nextCount; c++)
+			{
+				uint32_t v = next[c];
+				cachePosition[v] = c < CacheSize ? c : -1;
+				score[v] = VertexScore(cachePosition[v], remaining[v]);
+			}
+
+			// The next triangle is the best one touching the cache
+			best = -1;
+			bestScore = -1.0f;
+			cacheCount = nextCount < CacheSize ? nextCount : CacheSize;
+			for (int c = 0; c < cacheCount; c++)
+			{
+				uint32_t v = next[c];
+				cache[c] = v;
+				const uint32_t* list = &adjacency[offsets[v]];
+				for (uint32_t a = 0; a < remaining[v]; a++)
+				{
+					float s = triangleScore(list[a]);
+					if (s > bestScore)
+					{
+						best = static_cast<int>(list[a]);
+						bestScore = s;
+					}
+				}
+			}
+		}
+
+		// Meshes exported in strip order can already beat the greedy order
+		if (CacheMisses(output.data(), triangleCount * 3, localOf, vertexCount) < CacheMisses(indices, triangleCount * 3, localOf, vertexCount))
+			std::copy(output.begin(), output.end(), indices);
+		for (uint32_t v : globalOf) localOf[v] = ~0u;
+	}
+}
+
+void OptimizeVertexCache(MeshData& mesh)
+{
+	const uint32_t stride = MeshView::VertexStride(mesh.Attributes);
+	if (stride == 0) return;
+
+	std::vector<uint32_t> localOf(mesh.Vertices.size() / stride, ~0u);
+	for (const MeshShape& shape : mesh.Shapes)
+		OptimizeRange(mesh.Indices.data() + shape.FirstIndex, shape.IndexCount, localOf);
+}
+
+void OptimizeVertexFetch(MeshData& mesh)
+{
+	const uint32_t stride = MeshView::VertexStride(mesh.Attributes);
+	if (stride == 0) return;
+
+	const uint32_t vertexCount = static_cast<uint32_t>(mesh.Vertices.size() / stride);
+	std::vector<uint32_t> remap(vertexCount, ~0u);
+	std::vector<float> vertices;
+	vertices.reserve(mesh.Vertices.size());
+
+	// Vertices no index uses are dropped
+	for (uint32_t& index : mesh.Indices)
+	{
+		if (remap[index] == ~0u)
+		{
+			remap[index] = static_cast<uint32_t>(vertices.size() / stride);
+			vertices.insert(vertices.end(), mesh.Vertices.begin() + index * stride, mesh.Vertices.begin() + (index + 1) * stride);
+		}
+		index = remap[index];
+	}
+	mesh.Vertices.swap(vertices);
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include "MeshCache.h"
+
+// Reorders each shape's triangles so vertices are reused while they are still in the
+// GPU's post-transform cache (Forsyth's linear-speed algorithm). Shape ranges keep their
+// place; only the order of triangles within each one changes.
+void OptimizeVertexCache(MeshData& mesh);
+
+// Renumbers vertices in the order the indices first use them so vertex fetches walk
+// the buffer forward. Run after OptimizeVertexCache.
+void OptimizeVertexFetch(MeshData& mesh);
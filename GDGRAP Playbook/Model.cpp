@@ -1,9 +1,33 @@
 // Model.cpp
 #include "Model.h"
 
+#include <iostream>
+#include <unordered_map>
+
+#include "MeshOptimizer.h"
+
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 
+namespace {
+    // The OBJ indices of one face corner
+    struct ObjCorner {
+        int position, normal, texCoord;
+
+        bool operator==(const ObjCorner& other) const {
+            return position == other.position && normal == other.normal && texCoord == other.texCoord;
+        }
+    };
+
+    struct ObjCornerHash {
+        size_t operator()(const ObjCorner& corner) const {
+            uint64_t hash = static_cast<uint32_t>(corner.position);
+            hash = hash * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(corner.normal);
+            hash = hash * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(corner.texCoord);
+            return static_cast<size_t>(hash ^ (hash >> 32));
+        }
+    };
+}
 
 Model::Model(const std::string& path) {
     LoadModel(path);
@@ -16,16 +40,80 @@ Model::~Model() {
 }
 
 void Model::LoadModel(const std::string& path) {
+    // Use the binary cache when it is up to date; otherwise import the OBJ and write one
+    MeshCache cache;
+    if (cache.Open(path)) {
+        Upload(cache.View());
+        return;
+    }
+
+    MeshData mesh;
+    if (!ImportObj(path, mesh)) {
+        std::cerr << "Cannot load model " << path << std::endl;
+        return;
+    }
+
+    MeshView view = mesh.View();
+    std::string error;
+    if (!MeshCache::Write(path, view, error))
+        std::cerr << error << std::endl;
+
+    Upload(view);
+}
+
+bool Model::ImportObj(const std::string& path, MeshData& mesh) {
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
     std::string warning, error;
     tinyobj::attrib_t attributes;
 
     bool success = LoadObj(&attributes, &shapes, &materials, &warning, &error, path.c_str());
+    if (!success || shapes.empty()) return false;
+
+    // Normals and texture coordinates are kept when the file has any; corners without
+    // them get zeros
+    mesh.Attributes = MeshData::Position;
+    if (!attributes.normals.empty()) mesh.Attributes |= MeshData::Normal;
+    if (!attributes.texcoords.empty()) mesh.Attributes |= MeshData::TexCoord;
+    const unsigned int stride = MeshView::VertexStride(mesh.Attributes);
+
+    // Every distinct (position, normal, uv) corner becomes one vertex
+    std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> vertexOf;
+    for (const tinyobj::shape_t& shape : shapes) {
+        MeshShape range = { static_cast<uint32_t>(mesh.Indices.size()), 0 };
+
+        for (const tinyobj::index_t& index : shape.mesh.indices) {
+            ObjCorner corner = { index.vertex_index,
+                                 (mesh.Attributes & MeshData::Normal) ? index.normal_index : -1,
+                                 (mesh.Attributes & MeshData::TexCoord) ? index.texcoord_index : -1 };
+            auto inserted = vertexOf.emplace(corner, static_cast<uint32_t>(mesh.Vertices.size() / stride));
+            if (inserted.second) {
+                for (int k = 0; k < 3; k++)
+                    mesh.Vertices.push_back(attributes.vertices[3 * corner.position + k]);
+                if (mesh.Attributes & MeshData::Normal) {
+                    for (int k = 0; k < 3; k++)
+                        mesh.Vertices.push_back(corner.normal >= 0 ? attributes.normals[3 * corner.normal + k] : 0.0f);
+                }
+                if (mesh.Attributes & MeshData::TexCoord) {
+                    for (int k = 0; k < 2; k++)
+                        mesh.Vertices.push_back(corner.texCoord >= 0 ? attributes.texcoords[2 * corner.texCoord + k] : 0.0f);
+                }
+            }
+            mesh.Indices.push_back(inserted.first->second);
+        }
 
-    for (int i = 0; i < shapes[0].mesh.indices.size(); i++) {
-        mesh_indices.push_back(shapes[0].mesh.indices[i].vertex_index);
+        range.IndexCount = static_cast<uint32_t>(mesh.Indices.size()) - range.FirstIndex;
+        if (range.IndexCount > 0) mesh.Shapes.push_back(range);
     }
+    if (mesh.Indices.empty()) return false;
+
+    OptimizeVertexCache(mesh);
+    OptimizeVertexFetch(mesh);
+    return true;
+}
+
+void Model::Upload(const MeshView& mesh) {
+    indexCount = static_cast<GLsizei>(mesh.IndexCount);
 
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
@@ -33,24 +121,36 @@ void Model::LoadModel(const std::string& path) {
 
     glBindVertexArray(VAO);
 
+    const GLsizei stride = MeshView::VertexStride(mesh.Attributes) * sizeof(GLfloat);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * attributes.vertices.size(), &attributes.vertices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(mesh.VertexCount) * stride, mesh.Vertices, GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), nullptr);
-    glEnableVertexAttribArray(0);
+    // Attributes are interleaved in flag order
+    size_t offset = 0;
+    glVertexAttribPointer(PositionLocation, 3, GL_FLOAT, GL_FALSE, stride, nullptr);
+    glEnableVertexAttribArray(PositionLocation);
+    offset += 3 * sizeof(GLfloat);
+    if (mesh.Attributes & MeshData::Normal) {
+        glVertexAttribPointer(NormalLocation, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offset));
+        glEnableVertexAttribArray(NormalLocation);
+        offset += 3 * sizeof(GLfloat);
+    }
+    if (mesh.Attributes & MeshData::TexCoord) {
+        glVertexAttribPointer(TexCoordLocation, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offset));
+        glEnableVertexAttribArray(TexCoordLocation);
+    }
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * mesh_indices.size(), mesh_indices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * mesh.IndexCount, mesh.Indices, GL_STATIC_DRAW);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 }
 
-void Model::Draw(GLuint shaderProgram, const glm::mat4& transformation_matrix) {
-    unsigned int transformLoc = glGetUniformLocation(shaderProgram, "transform");
-    glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(transformation_matrix));
+void Model::Draw(ShaderProgram& shader, const glm::mat4& transformation_matrix) {
+    shader.Set(shader.Uniform(ShaderProgram::MVP), transformation_matrix);
 
-    glUseProgram(shaderProgram);
+    shader.Use();
     glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, mesh_indices.size(), GL_UNSIGNED_INT, nullptr);
+    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
 }
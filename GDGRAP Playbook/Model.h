@@ -6,21 +6,38 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "MeshCache.h"
+#include "ShaderProgram.h"
+
 #include <vector>
 #include <string>
 
 class Model
 {
 public:
+	// Vertex shader inputs the mesh feeds; normals and texture coordinates only when the
+	// source has them. Locations 1-5 belong to ParticleRenderer's instance data.
+	enum AttributeLocation
+	{
+		PositionLocation = 0,
+		NormalLocation = 6,
+		TexCoordLocation = 7
+	};
+
 	glm::vec3 Color;
 	glm::vec3 Position;
 
 	Model(const std::string& path);
 	~Model();
-	void Draw(GLuint shaderProgram, const glm::mat4& transformation_matrix);
+	void Draw(ShaderProgram& shader, const glm::mat4& transformation_matrix);
+
+	GLuint GetVertexArray() const { return VAO; }
+	GLsizei GetIndexCount() const { return indexCount; }
 
 private:
-	std::vector<GLuint> mesh_indices;
-	GLuint VAO, VBO, EBO;
+	GLsizei indexCount = 0;
+	GLuint VAO = 0, VBO = 0, EBO = 0;
 	void LoadModel(const std::string& path);
+	static bool ImportObj(const std::string& path, MeshData& mesh);
+	void Upload(const MeshView& mesh);
 };
@@ -0,0 +1,85 @@
+#include "ParticleRenderer.h"
+
+#include <cstddef>
+#include <utility>
+
+ParticleRenderer::~ParticleRenderer()
+{
+	for (Batch& batch : batches)
+	{
+		glDeleteBuffers(1, &batch.buffer);
+	}
+}
+
+ParticleRenderer::Batch& ParticleRenderer::BatchFor(Model* model)
+{
+	for (Batch& batch : batches)
+	{
+		if (batch.model == model) return batch;
+	}
+
+	Batch batch;
+	batch.model = model;
+	batch.capacity = 64;
+	glGenBuffers(1, &batch.buffer);
+
+	// The buffer is never empty, so drawing the Model without instancing still reads valid memory
+	glBindVertexArray(model->GetVertexArray());
+	glBindBuffer(GL_ARRAY_BUFFER, batch.buffer);
+	glBufferData(GL_ARRAY_BUFFER, batch.capacity * sizeof(Instance), nullptr, GL_STREAM_DRAW);
+
+	// A mat4 attribute takes four consecutive locations, one per column
+	for (GLuint column = 0; column < 4; column++)
+	{
+		GLuint location = 1 + column;
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+		                      reinterpret_cast<void*>(offsetof(Instance, transform) + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(location, 1);
+	}
+
+	glEnableVertexAttribArray(5);
+	glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), reinterpret_cast<void*>(offsetof(Instance, color)));
+	glVertexAttribDivisor(5, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	batches.push_back(std::move(batch));
+	return batches.back();
+}
+
+void ParticleRenderer::Add(Model* model, const glm::mat4& transform, const MyVector& color)
+{
+	BatchFor(model).instances.push_back(Instance{ transform, static_cast<glm::vec3>(color) });
+}
+
+void ParticleRenderer::Flush(ShaderProgram& shader, const glm::mat4& viewProjection)
+{
+	shader.Use();
+	shader.Set(shader.Uniform(ShaderProgram::MVP), viewProjection);
+	shader.Set(shader.Uniform(ShaderProgram::Instanced), 1);
+
+	for (Batch& batch : batches)
+	{
+		const GLsizeiptr count = static_cast<GLsizeiptr>(batch.instances.size());
+		if (count == 0) continue;
+
+		glBindBuffer(GL_ARRAY_BUFFER, batch.buffer);
+		while (batch.capacity < count) batch.capacity *= 2;
+
+		// Orphan last frame's storage so the upload does not wait for draws still reading it
+		glBufferData(GL_ARRAY_BUFFER, batch.capacity * sizeof(Instance), nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(Instance), batch.instances.data());
+
+		glBindVertexArray(batch.model->GetVertexArray());
+		glDrawElementsInstanced(GL_TRIANGLES, batch.model->GetIndexCount(), GL_UNSIGNED_INT, nullptr,
+		                        static_cast<GLsizei>(count));
+
+		batch.instances.clear();
+	}
+
+	shader.Set(shader.Uniform(ShaderProgram::Instanced), 0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
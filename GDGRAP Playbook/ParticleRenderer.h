@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+
+#include "Model.h"
+#include "ShaderProgram.h"
+#include "Physics/MyVector.h"
+
+// Draws many copies of a Model with one glDrawElementsInstanced call per Model.
+// Instances are queued with Add during the frame; Flush streams their transforms and
+// colors into a per-Model instance buffer and draws them. Needs the instanced inputs of
+// Shaders/sample.vert (locations 1-4 for the transform, 5 for the color).
+class ParticleRenderer
+{
+public:
+	ParticleRenderer() = default;
+	ParticleRenderer(const ParticleRenderer&) = delete;
+	ParticleRenderer& operator=(const ParticleRenderer&) = delete;
+	~ParticleRenderer();
+
+	void Add(Model* model, const glm::mat4& transform, const MyVector& color);
+
+	// Draws everything queued since the last Flush and empties the queue
+	void Flush(ShaderProgram& shader, const glm::mat4& viewProjection);
+
+private:
+	struct Instance
+	{
+		glm::mat4 transform;
+		glm::vec3 color;
+	};
+
+	struct Batch
+	{
+		Model* model;
+		GLuint buffer;
+		GLsizeiptr capacity; // Instances the buffer has room for
+		std::vector<Instance> instances;
+	};
+
+	Batch& BatchFor(Model* model);
+
+	std::vector<Batch> batches;
+};
@@ -0,0 +1,14 @@
+#include "ContactArena.h"
+
+ParticleContact* ContactArena::Allocate()
+{
+	if (used == contacts.size())
+	{
+		// Grow geometrically so steady state never reaches this branch
+		contacts.resize(contacts.empty() ? 64 : contacts.size() * 2);
+	}
+
+	ParticleContact* contact = &contacts[used++];
+	*contact = ParticleContact();
+	return contact;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+
+#include "ParticleContact.h"
+
+// Per-world storage for the contacts of one substep.
+// Reset() only rewinds the fill count, so once the arena has grown to the largest substep
+// seen no further heap allocations happen. Pointers returned by Allocate() stay valid
+// until the next Allocate() or Reset().
+class ContactArena
+{
+public:
+	// Returns a default-initialised contact owned by the arena
+	ParticleContact* Allocate();
+	void Reset() { used = 0; }
+
+	unsigned int Size() const { return used; }
+	bool Empty() const { return used == 0; }
+
+	ParticleContact* Data() { return contacts.data(); }
+	ParticleContact& operator[](unsigned int index) { return contacts[index]; }
+
+	ParticleContact* begin() { return contacts.data(); }
+	ParticleContact* end() { return contacts.data() + used; }
+	const ParticleContact* begin() const { return contacts.data(); }
+	const ParticleContact* end() const { return contacts.data() + used; }
+
+private:
+	std::vector<ParticleContact> contacts;
+	unsigned int used = 0;
+};
@@ -1,36 +1,348 @@
 #include "ContactResolver.h"
 
-void ContactResolver::ResolveContacts(std::list<ParticleContact*> contacts, float time)
+#include "Snapshot.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+
+namespace
 {
+    // One bit per color in particleColors; contacts left without a color share one more
+    // batch that is resolved on the calling thread
+    const unsigned int MaxColors = 64;
+
+    // A sweep that changes no normal speed by more than this ends SequentialImpulse early
+    const float SpeedTolerance = 1e-5f;
+    // Cached impulses only carry over to a contact whose normal turned by less than ~25 degrees
+    const float WarmStartAlignment = 0.9f;
+
+    bool PairLess(PhysicsParticle* const a[2], PhysicsParticle* const b[2])
+    {
+        std::less<PhysicsParticle*> less;
+        if (a[0] != b[0]) return less(a[0], b[0]);
+        return less(a[1], b[1]);
+    }
+
+    void ApplyImpulse(ParticleContact& contact, float impulse)
+    {
+        MyVector step = contact.contactNormal * impulse;
+        contact.particles[0]->Velocity() += step * contact.particles[0]->GetInverseMass();
+        if (contact.particles[1]) contact.particles[1]->Velocity() -= step * contact.particles[1]->GetInverseMass();
+    }
+}
+
+float ContactResolver::Severity(ParticleContact& contact, float time)
+{
+    float severity = contact.GetSeparatingSpeed();
+    if (contact.depth > 0.0f) severity = std::min(severity, -contact.depth / time);
+    return severity;
+}
+
+void ContactResolver::ResolveContacts(ParticleContact* contacts, unsigned int count, float time, WorkerPool* workers)
+{
+    if (count == 0)
+    {
+        cachedImpulses.clear();
+        return;
+    }
+
+    if (mode == SequentialImpulse)
+    {
+        ResolveSequentialImpulse(contacts, count, time);
+        return;
+    }
+    cachedImpulses.clear();
+
+    BuildAdjacency(contacts, count);
+
+    if (mode == Colored) ResolveColored(contacts, count, time, workers);
+    else ResolveMostSevereFirst(contacts, count, time);
+}
+
+void ContactResolver::ResolveMostSevereFirst(ParticleContact* contacts, unsigned int count, float time)
+{
+    keys.resize(count);
+    heap.resize(count);
+    heapPosition.resize(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        keys[i] = Severity(contacts[i], time);
+        heap[i] = i;
+        heapPosition[i] = i;
+    }
+    for (unsigned int i = count / 2; i > 0; i--) SiftDown(i - 1);
+
     unsigned int resolveCount = 0;
     while (resolveCount < max_iteration)
     {
-        // Find the contact with the largest closing velocity (most negative separating speed)
-        // or with penetration (depth > 0)
-        float minSepSpeed = std::numeric_limits<float>::max();
-        ParticleContact* contactToResolve = nullptr;
+        // The most severe contact is already separating and not penetrating, we're done
+        unsigned int worst = heap[0];
+        if (keys[worst] >= 0.0f) break;
 
-        for (auto contact : contacts)
+        // Resolve this contact
+        contacts[worst].Resolve(time);
+
+        // Only contacts touching the same particles can have changed; this includes the resolved one
+        for (unsigned int side = 0; side < 2; side++)
         {
-            float sepSpeed = contact->GetSeparatingSpeed();
-            if (sepSpeed < minSepSpeed || contact->depth > 0.0f)
+            for (unsigned int g = groupRanges[4 * worst + 2 * side]; g < groupRanges[4 * worst + 2 * side + 1]; g++)
             {
-                minSepSpeed = sepSpeed;
-                contactToResolve = contact;
+                unsigned int affected = particleContacts[g].second;
+                UpdateKey(affected, Severity(contacts[affected], time));
             }
         }
 
-        // If no contact needs resolving, break
-        if (!contactToResolve) break;
+        // Increment resolve count
+        ++resolveCount;
+    }
+}
+
+void ContactResolver::ResolveColored(ParticleContact* contacts, unsigned int count, float time, WorkerPool* workers)
+{
+    ColorContacts(contacts, count);
+
+    const bool parallel = workers && workers->GetThreadCount() > 0;
+    std::atomic<bool> resolved(false);
+    auto resolveRange = [this, contacts, time, &resolved](unsigned int begin, unsigned int end)
+    {
+        bool any = false;
+        for (unsigned int i = begin; i < end; i++)
+        {
+            ParticleContact& contact = contacts[colorOrder[i]];
+            if (Severity(contact, time) >= 0.0f) continue;
+
+            contact.Resolve(time);
+            any = true;
+        }
+        if (any) resolved.store(true, std::memory_order_relaxed);
+    };
+
+    for (unsigned int pass = 0; pass < max_passes; pass++)
+    {
+        resolved = false;
+        for (unsigned int color = 0; color < colorCount; color++)
+        {
+            const unsigned int begin = colorStart[color];
+            const unsigned int end = colorStart[color + 1];
+
+            // Batch contacts touch distinct particles, so any split of a batch is race free
+            if (parallel && color < MaxColors)
+            {
+                workers->ParallelFor(end - begin, 256, [begin, &resolveRange](unsigned int first, unsigned int last)
+                {
+                    resolveRange(begin + first, begin + last);
+                });
+            }
+            else resolveRange(begin, end);
+        }
+
+        if (!resolved) break;
+    }
+}
+
+void ContactResolver::ColorContacts(ParticleContact* contacts, unsigned int count)
+{
+    // Greedy coloring: each contact takes the lowest color free on both of its particles
+    particleColors.assign(particleContacts.size(), 0);
+    contactColors.resize(count);
+    colorCount = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        uint64_t& first = particleColors[groupRanges[4 * i]];
+        uint64_t* second = contacts[i].particles[1] ? &particleColors[groupRanges[4 * i + 2]] : nullptr;
+
+        const uint64_t taken = first | (second ? *second : 0);
+        unsigned int color = 0;
+        while (color < MaxColors && (taken & (uint64_t(1) << color))) color++;
 
-        // If the best contact is already separating and not penetrating, we're done
-        if (contactToResolve->GetSeparatingSpeed() >= 0.0f && contactToResolve->depth <= 0.0f)
+        if (color < MaxColors)
+        {
+            first |= uint64_t(1) << color;
+            if (second) *second |= uint64_t(1) << color;
+        }
+        contactColors[i] = color;
+        colorCount = std::max(colorCount, color + 1);
+    }
+
+    // Counting sort by color, keeping the contact order inside each color
+    colorStart.assign(colorCount + 1, 0);
+    for (unsigned int i = 0; i < count; i++) colorStart[contactColors[i] + 1]++;
+    for (unsigned int color = 0; color < colorCount; color++) colorStart[color + 1] += colorStart[color];
+
+    // Placing advances each start to the next color's, so shift them back afterwards
+    colorOrder.resize(count);
+    for (unsigned int i = 0; i < count; i++) colorOrder[colorStart[contactColors[i]]++] = i;
+    for (unsigned int color = colorCount; color > 0; color--) colorStart[color] = colorStart[color - 1];
+    colorStart[0] = 0;
+}
+
+void ContactResolver::ResolveSequentialImpulse(ParticleContact* contacts, unsigned int count, float time)
+{
+    impulses.assign(count, 0.0f);
+    targetSpeeds.resize(count);
+    effectiveMasses.resize(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        ParticleContact& contact = contacts[i];
+        float inverseMass = contact.particles[0]->GetInverseMass();
+        if (contact.particles[1]) inverseMass += contact.particles[1]->GetInverseMass();
+        effectiveMasses[i] = inverseMass > 0.0f ? 1.0f / inverseMass : 0.0f;
+
+        // Closing contacts bounce back by their restitution, measured before any impulse
+        float separatingSpeed = contact.GetSeparatingSpeed();
+        targetSpeeds[i] = separatingSpeed < 0.0f ? -contact.restitution * separatingSpeed : 0.0f;
+    }
+
+    if (warm_start) WarmStart(contacts, count);
+
+    for (unsigned int iteration = 0; iteration < impulse_iterations; iteration++)
+    {
+        float largestChange = 0.0f;
+        for (unsigned int i = 0; i < count; i++)
+        {
+            if (effectiveMasses[i] == 0.0f) continue;
+
+            float delta = effectiveMasses[i] * (targetSpeeds[i] - contacts[i].GetSeparatingSpeed());
+            // Contacts can only push, so the total impulse stays non-negative
+            float accumulated = std::max(impulses[i] + delta, 0.0f);
+            delta = accumulated - impulses[i];
+            if (delta == 0.0f) continue;
+
+            impulses[i] = accumulated;
+            ApplyImpulse(contacts[i], delta);
+            largestChange = std::max(largestChange, std::fabs(delta) / effectiveMasses[i]);
+        }
+        if (largestChange < SpeedTolerance) break;
+    }
+
+    for (unsigned int i = 0; i < count; i++) contacts[i].ResolveInterpenetration(time);
+
+    nextCachedImpulses.clear();
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (impulses[i] <= 0.0f) continue;
+
+        CachedImpulse cached = { { contacts[i].particles[0], contacts[i].particles[1] }, contacts[i].contactNormal, impulses[i] };
+        nextCachedImpulses.push_back(cached);
+    }
+    // Stable, so pairs with several contacts keep the contact order and match the same way every run
+    std::stable_sort(nextCachedImpulses.begin(), nextCachedImpulses.end(), [](const CachedImpulse& a, const CachedImpulse& b)
+    {
+        return PairLess(a.particles, b.particles);
+    });
+    cachedImpulses.swap(nextCachedImpulses);
+}
+
+void ContactResolver::WarmStart(ParticleContact* contacts, unsigned int count)
+{
+    if (cachedImpulses.empty()) return;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        ParticleContact& contact = contacts[i];
+        auto match = std::lower_bound(cachedImpulses.begin(), cachedImpulses.end(), contact.particles,
+            [](const CachedImpulse& cached, PhysicsParticle* const* pair) { return PairLess(cached.particles, pair); });
+
+        for (; match != cachedImpulses.end() && !PairLess(contact.particles, match->particles); ++match)
+        {
+            // A rod switching between stretched and compressed flips its normal
+            if (match->normal.ScalarProduct(contact.contactNormal) < WarmStartAlignment) continue;
+
+            impulses[i] = match->impulse;
+            ApplyImpulse(contact, match->impulse);
             break;
+        }
+    }
+}
 
-        // Resolve this contact
-        contactToResolve->Resolve(time);
+void ContactResolver::Save(SnapshotWriter& out) const
+{
+    out.WriteArray(cachedImpulses);
+}
 
-        // Increment resolve count
-        ++resolveCount;
+bool ContactResolver::Load(SnapshotReader& in)
+{
+    in.ReadArray(cachedImpulses);
+    for (const CachedImpulse& cached : cachedImpulses)
+    {
+        if (!cached.particles[0] || !in.IsKnown(cached.particles[0]) || !in.IsKnown(cached.particles[1])) in.Fail();
+    }
+    return !in.Failed();
+}
+
+void ContactResolver::BuildAdjacency(ParticleContact* contacts, unsigned int count)
+{
+    particleContacts.clear();
+    for (unsigned int i = 0; i < count; i++)
+    {
+        particleContacts.emplace_back(contacts[i].particles[0], i);
+        if (contacts[i].particles[1]) particleContacts.emplace_back(contacts[i].particles[1], i);
+    }
+    std::sort(particleContacts.begin(), particleContacts.end());
+
+    // Anchored contacts have no second particle and therefore an empty range
+    groupRanges.assign(4 * count, 0);
+
+    const unsigned int entries = static_cast<unsigned int>(particleContacts.size());
+    for (unsigned int begin = 0; begin < entries;)
+    {
+        unsigned int end = begin + 1;
+        while (end < entries && particleContacts[end].first == particleContacts[begin].first) end++;
+
+        for (unsigned int e = begin; e < end; e++)
+        {
+            unsigned int contact = particleContacts[e].second;
+            unsigned int side = contacts[contact].particles[0] == particleContacts[e].first ? 0 : 1;
+            groupRanges[4 * contact + 2 * side] = begin;
+            groupRanges[4 * contact + 2 * side + 1] = end;
+        }
+        begin = end;
+    }
+}
+
+void ContactResolver::UpdateKey(unsigned int contact, float key)
+{
+    float previous = keys[contact];
+    keys[contact] = key;
+
+    if (key < previous) SiftUp(heapPosition[contact]);
+    else if (key > previous) SiftDown(heapPosition[contact]);
+}
+
+void ContactResolver::SiftUp(unsigned int position)
+{
+    unsigned int contact = heap[position];
+    while (position > 0)
+    {
+        unsigned int parent = (position - 1) / 2;
+        if (keys[heap[parent]] <= keys[contact]) break;
+
+        heap[position] = heap[parent];
+        heapPosition[heap[position]] = position;
+        position = parent;
+    }
+    heap[position] = contact;
+    heapPosition[contact] = position;
+}
+
+void ContactResolver::SiftDown(unsigned int position)
+{
+    const unsigned int size = static_cast<unsigned int>(heap.size());
+    unsigned int contact = heap[position];
+    while (true)
+    {
+        unsigned int child = 2 * position + 1;
+        if (child >= size) break;
+        if (child + 1 < size && keys[heap[child + 1]] < keys[heap[child]]) child++;
+        if (keys[contact] <= keys[heap[child]]) break;
+
+        heap[position] = heap[child];
+        heapPosition[heap[position]] = position;
+        position = child;
     }
-}
\ No newline at end of file
+    heap[position] = contact;
+    heapPosition[contact] = position;
+}
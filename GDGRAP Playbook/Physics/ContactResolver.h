@@ -4,16 +4,107 @@
 
 #include "ParticleContact.h"
 #endif
-#include <list>
+#include <cstdint>
+#include <utility>
+#include <vector>
 
+class WorkerPool;
+class SnapshotWriter;
+class SnapshotReader;
+
+	// Resolves the most severe contact first, up to max_iteration times.
+	// Contacts live in an indexed min-heap keyed by severity, so each iteration only re-keys
+	// the resolved contact and the contacts sharing one of its particles instead of
+	// rescanning every contact.
+	//
+	// In Colored mode contacts are instead split into batches in which no two contacts share
+	// a particle, and each pass resolves every contact that needs it, one batch after the
+	// other, with the contacts of a batch spread over the workers. This runs at most
+	// max_passes passes, stopping early after a pass with nothing to resolve. Batches are
+	// built from the contact order alone, so the result does not depend on the thread count.
+	//
+	// SequentialImpulse mode is a projected Gauss-Seidel solver: each of up to
+	// impulse_iterations sweeps corrects every contact's normal velocity toward its target,
+	// keeping the impulse accumulated per contact non-negative. The accumulated impulses are
+	// kept per particle pair and applied up front in the next call (warm starting), so
+	// resting stacks and taut chains start close to their solution. Penetration is then
+	// projected out once per contact.
 	class ContactResolver
 	{
 	public:
+		enum Mode
+		{
+			MostSevereFirst,
+			Colored,
+			SequentialImpulse
+		};
+
 		unsigned int max_iteration;
+		Mode mode = MostSevereFirst;
+		unsigned int max_passes = 10; // Colored mode
+		unsigned int impulse_iterations = 10; // SequentialImpulse mode
+		bool warm_start = true; // SequentialImpulse mode
 		ContactResolver(unsigned int max_iterations)
 			: max_iteration(max_iterations), current_iteration(0) {}
-		void ResolveContacts(std::list<ParticleContact*> contacts, float time);
+		void ResolveContacts(ParticleContact* contacts, unsigned int count, float time, WorkerPool* workers = nullptr);
+
+		// Batches of the last Colored resolve
+		unsigned int GetColorCount() const { return colorCount; }
+
+		// The warm start impulses, which the next SequentialImpulse resolve depends on. Load
+		// fails on impulses of particles the reader does not know; Adopt takes over the
+		// impulses of a resolver loaded from a snapshot.
+		void Save(SnapshotWriter& out) const;
+		bool Load(SnapshotReader& in);
+		void Adopt(ContactResolver& loaded) { cachedImpulses.swap(loaded.cachedImpulses); }
 
 	protected:
 		unsigned int current_iteration;
-	};
\ No newline at end of file
+
+		// Lowest separating speed, counting penetration as the speed that would clear it in one step.
+		// A contact needs resolving while its severity is negative.
+		static float Severity(ParticleContact& contact, float time);
+
+		void BuildAdjacency(ParticleContact* contacts, unsigned int count);
+		void ResolveMostSevereFirst(ParticleContact* contacts, unsigned int count, float time);
+		void ResolveColored(ParticleContact* contacts, unsigned int count, float time, WorkerPool* workers);
+		void ColorContacts(ParticleContact* contacts, unsigned int count);
+		void ResolveSequentialImpulse(ParticleContact* contacts, unsigned int count, float time);
+		void WarmStart(ParticleContact* contacts, unsigned int count);
+		void UpdateKey(unsigned int contact, float key);
+		void SiftUp(unsigned int position);
+		void SiftDown(unsigned int position);
+
+		std::vector<float> keys; // Per contact
+		std::vector<unsigned int> heap; // Contact indices, most severe first
+		std::vector<unsigned int> heapPosition; // Per contact, where it sits in heap
+
+		// Contacts grouped by particle: (particle, contact) sorted by particle, plus for each
+		// contact and side the [begin, end) range of its particle's group
+		std::vector<std::pair<PhysicsParticle*, unsigned int>> particleContacts;
+		std::vector<unsigned int> groupRanges; // 4 per contact
+
+		// Colored mode: colors taken by each particle's contacts as a bit set, indexed by the
+		// start of its group, and the contacts ordered by color with the start of each color
+		std::vector<uint64_t> particleColors;
+		std::vector<unsigned int> contactColors;
+		std::vector<unsigned int> colorOrder;
+		std::vector<unsigned int> colorStart;
+		unsigned int colorCount = 0;
+
+		// SequentialImpulse mode: per contact, the impulse accumulated along its normal, the
+		// normal speed it is solved toward and the mass its impulse acts on
+		std::vector<float> impulses;
+		std::vector<float> targetSpeeds;
+		std::vector<float> effectiveMasses;
+
+		// Accumulated impulses of the last resolve, sorted by particle pair
+		struct CachedImpulse
+		{
+			PhysicsParticle* particles[2];
+			MyVector normal;
+			float impulse;
+		};
+		std::vector<CachedImpulse> cachedImpulses;
+		std::vector<CachedImpulse> nextCachedImpulses;
+	};
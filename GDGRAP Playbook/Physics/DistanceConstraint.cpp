@@ -0,0 +1,52 @@
+#include "DistanceConstraint.h"
+
+	DistanceConstraint::DistanceConstraint(PhysicsParticle* a, PhysicsParticle* b, float length, float compliance)
+		: length(length), compliance(compliance)
+	{
+		particles[0] = a;
+		particles[1] = b;
+	}
+
+	ParticleContact* DistanceConstraint::GetContact(ContactArena& contacts)
+	{
+		MyVector dir;
+		float currLen = (particles[1]->Position() - particles[0]->Position()).MagnitudeAndDirection(dir);
+		if (currLen == length) return nullptr;
+
+		ParticleContact* ret = contacts.Allocate();
+		ret->particles[0] = particles[0];
+		ret->particles[1] = particles[1];
+		ret->contactNormal = currLen > length ? dir : dir * -1;
+		ret->depth = currLen > length ? currLen - length : length - currLen;
+		ret->restitution = 0;
+		return ret;
+	}
+
+	void DistanceConstraint::Project(float time)
+	{
+		MyVector axis = particles[0]->Position() - particles[1]->Position();
+		float distance = axis.Magnitude();
+		float totalInverseMass = particles[0]->GetInverseMass() + particles[1]->GetInverseMass();
+		if (distance <= 0.0f || totalInverseMass <= 0.0f) return;
+
+		// XPBD: the compliance term makes the correction converge to the spring's equilibrium
+		float scaledCompliance = compliance / (time * time);
+		float delta = (length - distance - scaledCompliance * lambda) / (totalInverseMass + scaledCompliance);
+		lambda += delta;
+
+		MoveApart(axis * (1.0f / distance), delta * totalInverseMass);
+	}
+
+	void DistanceConstraint::Save(SnapshotWriter& out) const
+	{
+		ParticleLink::Save(out);
+		out.Write(length);
+		out.Write(compliance);
+	}
+
+	void DistanceConstraint::Load(SnapshotReader& in)
+	{
+		ParticleLink::Load(in);
+		in.Read(length);
+		in.Read(compliance);
+	}
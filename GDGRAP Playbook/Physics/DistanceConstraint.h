@@ -0,0 +1,25 @@
+#pragma once
+#include "ParticleLink.h"
+
+	// Keeps two particles length apart. In position-based stepping it is solved as an XPBD
+	// constraint: compliance (inverse stiffness, in metres per newton) 0 makes it rigid,
+	// larger values let it stretch like a spring whose stiffness does not depend on the step
+	// length or the iteration count. In contact-based stepping it acts as a rigid Rod.
+	class DistanceConstraint : public ParticleLink {
+	public:
+		DistanceConstraint() = default;
+		DistanceConstraint(PhysicsParticle* a, PhysicsParticle* b, float length, float compliance = 0.0f);
+
+		float length = 1;
+		float compliance = 0;
+
+		ParticleContact* GetContact(ContactArena& contacts) override;
+		bool CanProject() const override { return true; }
+		void StartProjection() override { lambda = 0.0f; }
+		void Project(float time) override;
+		void Save(SnapshotWriter& out) const override;
+		void Load(SnapshotReader& in) override;
+
+	private:
+		float lambda = 0; // Accumulated over the iterations of one step
+	};
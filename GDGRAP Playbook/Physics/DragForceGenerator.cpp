@@ -1,14 +1,36 @@
 #include "DragForceGenerator.h"
 
+#include <cmath>
+
 void DragForceGenerator::UpdateForce(PhysicsParticle* particle, float time)
 {
 	MyVector force = MyVector(0, 0, 0);
-	MyVector currV = particle->Velocity;
+	MyVector currV = particle->Velocity();
 
 	float mag = currV.magnitude();
 	if (mag <= 0.0f) return; //no drag if no velocity
 
 	float dragF = (k1 * mag) + (k2 * mag);
-	MyVector dir = currV.normalize(); //make normalize();
+	MyVector dir = currV.Direction(mag);
 	particle->AddForce(dir * -dragF);
 }
+
+void DragForceGenerator::UpdateForces(ParticleStore& store, const unsigned int* indices, unsigned int count, float time)
+{
+	const MyVector* velocities = store.Velocities.data();
+	MyVector* forces = store.AccumulatedForces.data();
+
+	for (unsigned int n = 0; n < count; n++)
+	{
+		unsigned int i = indices[n];
+		const MyVector& v = velocities[i];
+
+		float mag = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+		if (mag <= 0.0f) continue; //no drag if no velocity
+
+		float dragF = (k1 * mag) + (k2 * mag);
+		forces[i].x += (v.x / mag) * -dragF;
+		forces[i].y += (v.y / mag) * -dragF;
+		forces[i].z += (v.z / mag) * -dragF;
+	}
+}
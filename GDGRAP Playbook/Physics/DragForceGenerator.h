@@ -18,4 +18,7 @@ public:
 	}
 
 	void UpdateForce(PhysicsParticle* particle, float time) override;
+
+	bool IsBatched() const override { return true; }
+	void UpdateForces(ParticleStore& store, const unsigned int* indices, unsigned int count, float time) override;
 };
@@ -2,12 +2,51 @@
 
 #include "MyVector.h"
 #include "PhysicsParticle.h"
+#include "ParticleStore.h"
 
 class ForceGenerator
 {
 public:
+	virtual ~ForceGenerator() = default;
+
 	virtual void UpdateForce(PhysicsParticle* p, float time)
 	{
 		p->AddForce(MyVector(0, 0, 0));
 	}
+
+	// Particle the generator ties its particles to (springs), or nullptr. Tied particles
+	// share an island and fall asleep together.
+	virtual PhysicsParticle* GetConnectedParticle() const { return nullptr; }
+
+	// The force law of a spring generator, for ImplicitSpringSolver. The spring pulls the
+	// particle toward other, or toward anchor when other is null, with a tension of
+	// stiffness times how far its length is from restLength (Absolute), or only by how far
+	// it is stretched past restLength (StretchOnly).
+	struct Spring
+	{
+		enum Law
+		{
+			Absolute,
+			StretchOnly
+		};
+
+		PhysicsParticle* other = nullptr;
+		MyVector anchor;
+		float stiffness = 0;
+		float restLength = 0;
+		Law law = Absolute;
+	};
+	// Generators returning true are solved implicitly when PhysicsWorld::ImplicitSprings is
+	// set, and UpdateForce is not called for them
+	virtual bool GetSpring(Spring& spring) const { return false; }
+
+	// Generators returning true are handed all of their registered particles at once
+	// through UpdateForces instead of one virtual call per particle
+	virtual bool IsBatched() const { return false; }
+
+	// Applies the force to the particles at the given dense indices of store.
+	// Each index appears at most once.
+	virtual void UpdateForces(ParticleStore& store, const unsigned int* indices, unsigned int count, float time)
+	{
+	}
 };
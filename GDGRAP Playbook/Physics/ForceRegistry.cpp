@@ -1,5 +1,8 @@
 #include "ForceRegistry.h"
 
+#include <algorithm>
+#include <cstdint>
+
 void ForceRegistry::Add(PhysicsParticle* particle, ForceGenerator* generator)
 {
 	ParticleForceRegistry toAdd;
@@ -7,6 +10,8 @@ void ForceRegistry::Add(PhysicsParticle* particle, ForceGenerator* generator)
 	toAdd.particle = particle;
 	toAdd.generator = generator;
 	Registry.push_back(toAdd);
+	groupsDirty = true;
+	version++;
 }
 
 void ForceRegistry::Remove(PhysicsParticle* particle, ForceGenerator* generator)
@@ -17,17 +22,217 @@ void ForceRegistry::Remove(PhysicsParticle* particle, ForceGenerator* generator)
 			return reg.particle == particle && reg.generator == generator;
 		}
 	);
+	groupsDirty = true;
+	version++;
 }
 
 void ForceRegistry::Clear()
 {
 	Registry.clear();
+	groupsDirty = true;
+	version++;
 }
 
-void ForceRegistry::UpdateForces(float time)
+void ForceRegistry::UpdateForces(float time, WorkerPool* workers)
 {
-	for (std::list<ParticleForceRegistry>::iterator i = Registry.begin(); i != Registry.end(); i++)
+	if (GroupsOutdated()) RebuildGroups();
+
+	const bool parallel = workers && workers->GetThreadCount() > 0;
+
+	for (Batch& batch : batches)
 	{
-		i->generator->UpdateForce(i->particle, time);
+		const unsigned int count = static_cast<unsigned int>(batch.indices.size());
+		if (!parallel)
+		{
+			batch.generator->UpdateForces(*batch.store, batch.indices.data(), count, time);
+			continue;
+		}
+
+		workers->ParallelFor(count, 1024, [&batch, time](unsigned int begin, unsigned int end)
+		{
+			batch.generator->UpdateForces(*batch.store, batch.indices.data() + begin, end - begin, time);
+		});
 	}
+
+	const unsigned int groups = static_cast<unsigned int>(groupStart.size()) - 1;
+	auto updateGroups = [this, time](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = groupStart[begin]; i < groupStart[end]; i++)
+		{
+			byParticle[i].generator->UpdateForce(byParticle[i].particle, time);
+		}
+	};
+
+	if (parallel) workers->ParallelFor(groups, 64, updateGroups);
+	else updateGroups(0, groups);
+}
+
+void ForceRegistry::SetImplicitSprings(bool implicit)
+{
+	if (implicit == implicitSprings) return;
+	implicitSprings = implicit;
+	groupsDirty = true;
+}
+
+const std::vector<ForceRegistry::SpringRegistration>& ForceRegistry::GetSprings()
+{
+	if (GroupsOutdated()) RebuildGroups();
+	return springs;
+}
+
+const std::vector<ForceRegistry::Connection>& ForceRegistry::GetConnections()
+{
+	// Connections hold particles rather than indices, so only Add/Remove/Clear outdate them
+	if (groupsDirty) RebuildGroups();
+	return connections;
+}
+
+bool ForceRegistry::GroupsOutdated() const
+{
+	if (groupsDirty) return true;
+	for (const StoreLayout& layout : groupsLayouts)
+	{
+		if (layout.store->LayoutVersion() != layout.version) return true;
+	}
+	for (const PhysicsParticle* particle : unboundParticles)
+	{
+		if (particle->GetStore()) return true;
+	}
+	return false;
+}
+
+void ForceRegistry::RebuildGroups()
+{
+	batches.clear();
+	byParticle.clear();
+	connections.clear();
+	springs.clear();
+	groupsLayouts.clear();
+	unboundParticles.clear();
+
+	ForceGenerator::Spring spring;
+	for (const ParticleForceRegistry& reg : Registry)
+	{
+		PhysicsParticle* other = reg.generator->GetConnectedParticle();
+		if (other) connections.push_back(Connection{ reg.particle, other });
+
+		ParticleStore* store = reg.particle->GetStore();
+		if (!store) unboundParticles.push_back(reg.particle);
+		else if (std::none_of(groupsLayouts.begin(), groupsLayouts.end(),
+		                      [store](const StoreLayout& layout) { return layout.store == store; }))
+		{
+			groupsLayouts.push_back(StoreLayout{ store, store->LayoutVersion() });
+		}
+		if (store && store->Asleep[store->IndexOf(reg.particle->GetHandle())]) continue;
+
+		if (implicitSprings && reg.generator->GetSpring(spring))
+		{
+			springs.push_back(SpringRegistration{ reg.particle, reg.generator });
+			continue;
+		}
+
+		if (!reg.generator->IsBatched() || !store)
+		{
+			byParticle.push_back(reg);
+			continue;
+		}
+
+		Batch* batch = nullptr;
+		for (Batch& candidate : batches)
+		{
+			if (candidate.generator == reg.generator && candidate.store == store) batch = &candidate;
+		}
+		if (!batch)
+		{
+			batches.push_back(Batch{ reg.generator, store, {} });
+			batch = &batches.back();
+		}
+		batch->indices.push_back(store->IndexOf(reg.particle->GetHandle()));
+	}
+
+	// Ascending indices walk the store arrays in order. A particle registered twice with the
+	// same generator keeps its first entry in the batch and the rest go through UpdateForce.
+	for (Batch& batch : batches)
+	{
+		std::sort(batch.indices.begin(), batch.indices.end());
+
+		unsigned int kept = 0;
+		for (unsigned int i = 0; i < batch.indices.size(); i++)
+		{
+			if (kept > 0 && batch.indices[kept - 1] == batch.indices[i])
+			{
+				byParticle.push_back(ParticleForceRegistry{ batch.store->Owners[batch.indices[i]], batch.generator });
+				continue;
+			}
+			batch.indices[kept++] = batch.indices[i];
+		}
+		batch.indices.resize(kept);
+	}
+
+	// Stable so that each particle keeps its registry order
+	std::stable_sort(byParticle.begin(), byParticle.end(),
+	                 [](const ParticleForceRegistry& a, const ParticleForceRegistry& b)
+	                 {
+		                 return a.particle < b.particle;
+	                 });
+
+	groupStart.clear();
+	for (unsigned int i = 0; i < byParticle.size(); i++)
+	{
+		if (i == 0 || byParticle[i].particle != byParticle[i - 1].particle) groupStart.push_back(i);
+	}
+	groupStart.push_back(static_cast<unsigned int>(byParticle.size()));
+
+	groupsDirty = false;
+}
+
+void ForceRegistry::Save(SnapshotWriter& out) const
+{
+	out.Write(static_cast<unsigned int>(Registry.size()));
+	for (const ParticleForceRegistry& registration : Registry)
+	{
+		out.WritePointer(registration.particle);
+		out.WritePointer(registration.generator);
+	}
+}
+
+bool ForceRegistry::Load(SnapshotReader& in, const ForceRegistry& current)
+{
+	std::unordered_set<uintptr_t> generators;
+	for (const ParticleForceRegistry& registration : current.Registry)
+	{
+		generators.insert(reinterpret_cast<uintptr_t>(registration.generator));
+	}
+
+	unsigned int count = 0;
+	in.Read(count);
+	Registry.clear();
+	for (unsigned int i = 0; i < count && !in.Failed(); i++)
+	{
+		ParticleForceRegistry registration;
+		uintptr_t generator = 0;
+		in.ReadPointer(registration.particle);
+		in.Read(generator);
+		if (!registration.particle || generators.count(generator) == 0)
+		{
+			in.Fail();
+			break;
+		}
+		registration.generator = reinterpret_cast<ForceGenerator*>(generator);
+		Registry.push_back(registration);
+	}
+	groupsDirty = true;
+	return !in.Failed();
+}
+
+void ForceRegistry::Adopt(ForceRegistry& loaded)
+{
+	Registry.swap(loaded.Registry);
+	groupsDirty = true;
+	version++;
+}
+
+void ForceRegistry::CollectParticles(std::unordered_set<const void*>& particles) const
+{
+	for (const ParticleForceRegistry& registration : Registry) particles.insert(registration.particle);
 }
@@ -1,3 +1,4 @@
+#pragma once
 #ifndef P6PARTICLE_DEF
 #define P6PARTICLE_DEF
 
@@ -11,6 +12,11 @@
 #endif
 
 #include "list"
+#include <unordered_set>
+#include <vector>
+
+#include "Snapshot.h"
+#include "WorkerPool.h"
 
 class ForceRegistry
 {
@@ -18,7 +24,44 @@ public:
 	void Add(PhysicsParticle* particle, ForceGenerator* generator);
 	void Remove(PhysicsParticle* particle, ForceGenerator* generator);
 	void Clear();
-	void UpdateForces(float time);
+	// Batched generators (gravity, drag) run first, each over all of its particles in one call,
+	// in the order they were first registered. The remaining registrations follow, split by
+	// particle when workers are given, so each particle's forces are summed by one thread in a
+	// fixed order and the result is the same for any thread count.
+	// Sleeping particles are skipped.
+	void UpdateForces(float time, WorkerPool* workers = nullptr);
+
+	// When set, registrations whose generator describes a spring (ForceGenerator::GetSpring)
+	// are left out of UpdateForces and listed by GetSprings instead
+	void SetImplicitSprings(bool implicit);
+	struct SpringRegistration
+	{
+		PhysicsParticle* particle;
+		ForceGenerator* generator;
+	};
+	// Awake particles only
+	const std::vector<SpringRegistration>& GetSprings();
+
+	// A registration whose generator ties its particle to another one (springs)
+	struct Connection
+	{
+		PhysicsParticle* particle;
+		PhysicsParticle* other;
+	};
+	const std::vector<Connection>& GetConnections();
+
+	// Bumped whenever registrations are added, removed or loaded
+	unsigned int Version() const { return version; }
+
+	// Snapshot support: the registrations, in order. Generators are saved by address only,
+	// so Load reads into an empty registry and only accepts particles the reader knows and
+	// generators current still has registered. Adopt takes over a loaded registry's
+	// registrations.
+	void Save(SnapshotWriter& out) const;
+	bool Load(SnapshotReader& in, const ForceRegistry& current);
+	void Adopt(ForceRegistry& loaded);
+	// Adds every registered particle to particles
+	void CollectParticles(std::unordered_set<const void*>& particles) const;
 
 protected:
 	struct ParticleForceRegistry
@@ -28,4 +71,32 @@ protected:
 	};
 
 	std::list<ParticleForceRegistry> Registry;
+
+	struct Batch
+	{
+		ForceGenerator* generator;
+		ParticleStore* store;
+		std::vector<unsigned int> indices; // Ascending dense indices into store
+	};
+
+	// Dispatch tables derived from Registry, rebuilt after Add/Remove/Clear or when particles
+	// move, fall asleep or wake in one of the stores they were built from, or when a particle
+	// that had no store is bound to one
+	bool GroupsOutdated() const;
+	void RebuildGroups();
+	bool groupsDirty = true;
+	unsigned int version = 0;
+	struct StoreLayout
+	{
+		const ParticleStore* store;
+		unsigned int version;
+	};
+	std::vector<StoreLayout> groupsLayouts;
+	std::vector<const PhysicsParticle*> unboundParticles;
+	std::vector<Batch> batches;
+	std::vector<ParticleForceRegistry> byParticle; // Unbatched registrations sorted by particle
+	std::vector<unsigned int> groupStart; // Start of each particle's run in byParticle, one extra at the end
+	std::vector<Connection> connections;
+	bool implicitSprings = false;
+	std::vector<SpringRegistration> springs;
 };
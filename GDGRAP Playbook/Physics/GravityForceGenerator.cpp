@@ -2,8 +2,24 @@
 
 void GravityForceGenerator::UpdateForce(PhysicsParticle* particle, float time)
 {
-	if (particle->mass <= 0) return;
+	if (particle->GetMass() <= 0) return;
 
-	MyVector force = Gravity * particle->mass;
+	MyVector force = Gravity * particle->GetMass();
 	particle->AddForce(force);
 }
+
+void GravityForceGenerator::UpdateForces(ParticleStore& store, const unsigned int* indices, unsigned int count, float time)
+{
+	const float* masses = store.Masses.data();
+	MyVector* forces = store.AccumulatedForces.data();
+
+	for (unsigned int n = 0; n < count; n++)
+	{
+		unsigned int i = indices[n];
+		if (masses[i] <= 0) continue;
+
+		forces[i].x += Gravity.x * masses[i];
+		forces[i].y += Gravity.y * masses[i];
+		forces[i].z += Gravity.z * masses[i];
+	}
+}
@@ -12,5 +12,10 @@ public:
 	{
 	}
 
+	const MyVector& GetGravity() const { return Gravity; }
+
 	void UpdateForce(PhysicsParticle* particle, float time) override;
+
+	bool IsBatched() const override { return true; }
+	void UpdateForces(ParticleStore& store, const unsigned int* indices, unsigned int count, float time) override;
 };
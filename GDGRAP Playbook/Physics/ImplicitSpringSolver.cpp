@@ -0,0 +1,331 @@
+#include "ImplicitSpringSolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "WorkerPool.h"
+
+namespace
+{
+	// Rows per job; fixed so sums come out the same on any number of threads
+	const unsigned int RowChunk = 1024;
+
+	bool Inverse(const float* m, float* out)
+	{
+		float c0 = m[4] * m[8] - m[5] * m[7];
+		float c1 = m[5] * m[6] - m[3] * m[8];
+		float c2 = m[3] * m[7] - m[4] * m[6];
+		float determinant = m[0] * c0 + m[1] * c1 + m[2] * c2;
+		if (determinant == 0.0f) return false;
+
+		float inverse = 1.0f / determinant;
+		out[0] = c0 * inverse;
+		out[1] = (m[2] * m[7] - m[1] * m[8]) * inverse;
+		out[2] = (m[1] * m[5] - m[2] * m[4]) * inverse;
+		out[3] = c1 * inverse;
+		out[4] = (m[0] * m[8] - m[2] * m[6]) * inverse;
+		out[5] = (m[2] * m[3] - m[0] * m[5]) * inverse;
+		out[6] = c2 * inverse;
+		out[7] = (m[1] * m[6] - m[0] * m[7]) * inverse;
+		out[8] = (m[0] * m[4] - m[1] * m[3]) * inverse;
+		return true;
+	}
+}
+
+void ImplicitSpringSolver::Apply(ParticleStore& store, const std::vector<ForceRegistry::SpringRegistration>& springs,
+                                 const std::list<SpringSet*>& springSets, float time, WorkerPool* workers)
+{
+	iterations = 0;
+	solution.clear();
+	if (time <= 0.0f) return;
+
+	// Every spring as seen from each particle it pulls; a SpringSet spring pulls both ends
+	halfSprings.clear();
+	HalfSpring half;
+	for (const ForceRegistry::SpringRegistration& registration : springs)
+	{
+		if (registration.particle->GetStore() != &store || !registration.generator->GetSpring(half.spring)) continue;
+
+		half.index = store.IndexOf(registration.particle->GetHandle());
+		halfSprings.push_back(half);
+	}
+	for (const SpringSet* set : springSets)
+	{
+		for (unsigned int i = 0; i < set->Size(); i++)
+		{
+			set->GetSpring(i, half.spring);
+			PhysicsParticle* first = set->GetParticle(i, 0);
+			PhysicsParticle* second = half.spring.other;
+			if (first->GetStore() == &store)
+			{
+				half.index = store.IndexOf(first->GetHandle());
+				halfSprings.push_back(half);
+			}
+			if (second && second->GetStore() == &store)
+			{
+				half.index = store.IndexOf(second->GetHandle());
+				half.spring.other = first;
+				halfSprings.push_back(half);
+			}
+		}
+	}
+	if (halfSprings.empty()) return;
+
+	// One row per particle that has a spring and can move
+	nodeOf.assign(store.Size(), -1);
+	nodeParticle.clear();
+	for (const HalfSpring& spring : halfSprings)
+	{
+		const unsigned int index = spring.index;
+		if (nodeOf[index] >= 0 || store.Asleep[index] || store.Destroyed[index] || store.InverseMasses[index] <= 0.0f) continue;
+
+		nodeOf[index] = static_cast<int>(nodeParticle.size());
+		nodeParticle.push_back(index);
+	}
+
+	const unsigned int count = static_cast<unsigned int>(nodeParticle.size());
+	if (count == 0) return;
+
+	const float h = time;
+	diagonal.assign(count, Block());
+	rhs.assign(count, MyVector(0, 0, 0));
+	for (unsigned int row = 0; row < count; row++)
+	{
+		const float mass = store.Masses[nodeParticle[row]];
+		diagonal[row].m[0] = diagonal[row].m[4] = diagonal[row].m[8] = mass;
+	}
+
+	couplings.clear();
+	for (const HalfSpring& half : halfSprings)
+	{
+		const unsigned int index = half.index;
+		const ForceGenerator::Spring& spring = half.spring;
+		const int row = nodeOf[index];
+		if (row < 0) continue;
+
+		MyVector otherPosition = spring.anchor;
+		MyVector otherVelocity(0, 0, 0);
+		int otherRow = -1;
+		if (spring.other)
+		{
+			otherPosition = spring.other->Position();
+			otherVelocity = spring.other->Velocity();
+			if (spring.other->GetStore() == &store) otherRow = nodeOf[store.IndexOf(spring.other->GetHandle())];
+		}
+
+		const MyVector offset = store.Positions[index] - otherPosition;
+		const float length = offset.Magnitude();
+		if (length <= 0.0f) continue;
+
+		const MyVector axis = offset * (1.0f / length);
+		const float stretch = length - spring.restLength;
+
+		// Tension pulls the particle toward the other end. Its change along the axis is only
+		// counted while it restores the rest length, keeping K negative semi-definite.
+		float tension, axialStiffness;
+		if (spring.law == ForceGenerator::Spring::StretchOnly)
+		{
+			if (stretch <= 0.0f) continue;
+			tension = spring.stiffness * stretch;
+			axialStiffness = spring.stiffness;
+		}
+		else
+		{
+			tension = spring.stiffness * std::fabs(stretch);
+			axialStiffness = stretch > 0.0f ? spring.stiffness : 0.0f;
+		}
+		const float transverseStiffness = tension / length;
+
+		// J = -df/dx of the particle: transverse on the whole space plus the axial difference along the axis
+		Block jacobian;
+		const float a[3] = { axis.x, axis.y, axis.z };
+		for (int r = 0; r < 3; r++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				jacobian.m[3 * r + c] = (axialStiffness - transverseStiffness) * a[r] * a[c] + (r == c ? transverseStiffness : 0.0f);
+			}
+		}
+
+		const MyVector force = axis * -tension;
+		const MyVector relativeVelocity = store.Velocities[index] - otherVelocity;
+		rhs[row] += force * h - jacobian * relativeVelocity * (h * h);
+
+		for (int k = 0; k < 9; k++) diagonal[row].m[k] += h * h * jacobian.m[k];
+		if (otherRow >= 0)
+		{
+			Coupling coupling;
+			coupling.row = static_cast<unsigned int>(row);
+			coupling.column = static_cast<unsigned int>(otherRow);
+			for (int k = 0; k < 9; k++) coupling.block.m[k] = -h * h * jacobian.m[k];
+			couplings.push_back(coupling);
+		}
+	}
+
+	// Bucket the couplings by row, merging those of the same pair
+	bucketStart.assign(count + 1, 0);
+	for (const Coupling& coupling : couplings) bucketStart[coupling.row + 1]++;
+	for (unsigned int row = 0; row < count; row++) bucketStart[row + 1] += bucketStart[row];
+	bucketed.resize(couplings.size());
+	bucketEnd.assign(bucketStart.begin(), bucketStart.end() - 1);
+	for (const Coupling& coupling : couplings) bucketed[bucketEnd[coupling.row]++] = coupling;
+	for (unsigned int row = 0; row < count; row++)
+	{
+		unsigned int end = bucketStart[row];
+		for (unsigned int i = bucketStart[row]; i < bucketEnd[row]; i++)
+		{
+			unsigned int j = bucketStart[row];
+			while (j < end && bucketed[j].column != bucketed[i].column) j++;
+			if (j < end)
+			{
+				for (int k = 0; k < 9; k++) bucketed[j].block.m[k] += bucketed[i].block.m[k];
+			}
+			else bucketed[end++] = bucketed[i];
+		}
+		bucketEnd[row] = end;
+	}
+
+	// Keep only pairs registered from both ends, averaged so the matrix is symmetric
+	rowStart.assign(count + 1, 0);
+	columns.clear();
+	blocks.clear();
+	for (unsigned int row = 0; row < count; row++)
+	{
+		for (unsigned int i = bucketStart[row]; i < bucketEnd[row]; i++)
+		{
+			const Coupling& coupling = bucketed[i];
+			const Coupling* transpose = nullptr;
+			for (unsigned int j = bucketStart[coupling.column]; j < bucketEnd[coupling.column] && !transpose; j++)
+			{
+				if (bucketed[j].column == row) transpose = &bucketed[j];
+			}
+			if (!transpose) continue;
+
+			Block block;
+			for (int r = 0; r < 3; r++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					block.m[3 * r + c] = 0.5f * (coupling.block.m[3 * r + c] + transpose->block.m[3 * c + r]);
+				}
+			}
+			columns.push_back(coupling.column);
+			blocks.push_back(block);
+		}
+		rowStart[row + 1] = static_cast<unsigned int>(columns.size());
+	}
+
+	preconditioner.resize(count);
+	for (unsigned int row = 0; row < count; row++)
+	{
+		if (!Inverse(diagonal[row].m, preconditioner[row].m)) preconditioner[row] = Block();
+	}
+
+	auto forRows = [workers, count](const WorkerPool::RangeFunction& body)
+	{
+		if (workers) workers->ParallelFor(count, RowChunk, body);
+		else body(0, count);
+	};
+	auto precondition = [this, &forRows]()
+	{
+		forRows([this](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int row = begin; row < end; row++) preconditioned[row] = preconditioner[row] * residual[row];
+		});
+	};
+
+	// Preconditioned conjugate gradients from dv = 0
+	solution.assign(count, MyVector(0, 0, 0));
+	residual = rhs;
+	preconditioned.resize(count);
+	product.resize(count);
+	precondition();
+	direction = preconditioned;
+
+	const double threshold = static_cast<double>(Tolerance) * Tolerance * Dot(rhs, rhs, workers);
+	double residualDotPreconditioned = Dot(residual, preconditioned, workers);
+	while (iterations < MaxIterations && threshold > 0.0)
+	{
+		Multiply(direction, product, workers);
+		const double curvature = Dot(direction, product, workers);
+		if (curvature <= 0.0) break;
+
+		const float alpha = static_cast<float>(residualDotPreconditioned / curvature);
+		forRows([this, alpha](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int row = begin; row < end; row++)
+			{
+				solution[row] += direction[row] * alpha;
+				residual[row] -= product[row] * alpha;
+			}
+		});
+		iterations++;
+
+		if (Dot(residual, residual, workers) <= threshold) break;
+
+		precondition();
+		const double next = Dot(residual, preconditioned, workers);
+		const float beta = static_cast<float>(next / residualDotPreconditioned);
+		residualDotPreconditioned = next;
+		forRows([this, beta](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int row = begin; row < end; row++) direction[row] = preconditioned[row] + direction[row] * beta;
+		});
+	}
+
+	// The integrator turns force back into dv = F / m * h
+	for (unsigned int row = 0; row < count; row++)
+	{
+		const unsigned int index = nodeParticle[row];
+		store.AccumulatedForces[index] += solution[row] * (store.Masses[index] / h);
+	}
+}
+
+void ImplicitSpringSolver::CorrectPositions(ParticleStore& store, float time)
+{
+	for (unsigned int row = 0; row < solution.size(); row++)
+	{
+		store.Positions[nodeParticle[row]] += solution[row] * (0.5f * time);
+	}
+}
+
+void ImplicitSpringSolver::Multiply(const std::vector<MyVector>& x, std::vector<MyVector>& y, WorkerPool* workers)
+{
+	auto multiplyRows = [this, &x, &y](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int row = begin; row < end; row++)
+		{
+			MyVector sum = diagonal[row] * x[row];
+			for (unsigned int k = rowStart[row]; k < rowStart[row + 1]; k++) sum += blocks[k] * x[columns[k]];
+			y[row] = sum;
+		}
+	};
+
+	const unsigned int count = static_cast<unsigned int>(x.size());
+	if (workers) workers->ParallelFor(count, RowChunk, multiplyRows);
+	else multiplyRows(0, count);
+}
+
+double ImplicitSpringSolver::Dot(const std::vector<MyVector>& a, const std::vector<MyVector>& b, WorkerPool* workers)
+{
+	const unsigned int count = static_cast<unsigned int>(a.size());
+	const unsigned int chunks = (count + RowChunk - 1) / RowChunk;
+	partialSums.assign(chunks, 0.0);
+
+	auto sumChunks = [this, &a, &b, count](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int chunk = begin; chunk < end; chunk++)
+		{
+			double sum = 0.0;
+			const unsigned int last = std::min((chunk + 1) * RowChunk, count);
+			for (unsigned int i = chunk * RowChunk; i < last; i++) sum += a[i].ScalarProduct(b[i]);
+			partialSums[chunk] = sum;
+		}
+	};
+	if (workers) workers->ParallelFor(chunks, 1, sumChunks);
+	else sumChunks(0, chunks);
+
+	double total = 0.0;
+	for (double sum : partialSums) total += sum;
+	return total;
+}
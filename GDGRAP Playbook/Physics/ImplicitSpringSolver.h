@@ -0,0 +1,90 @@
+#pragma once
+#include <list>
+#include <vector>
+
+#include "ForceRegistry.h"
+#include "ParticleStore.h"
+#include "SpringSet.h"
+
+class WorkerPool;
+
+// Backward Euler for spring generators and SpringSets (PhysicsWorld::ImplicitSprings).
+// Each step the springs' forces are linearised around the current positions, and
+//     (M - h^2 K) dv = h (f + h K v)
+// is solved for the velocity change dv, where K is the springs' Jacobian, assembled as a
+// block sparse matrix with one 3x3 block per pair of connected particles, and h the step.
+// The system is solved with conjugate gradients preconditioned by the inverted 3x3 diagonal
+// blocks. The resulting dv is handed to the integrator as a force, so stiff springs no
+// longer need tiny steps to stay stable.
+//
+// K is kept negative semi-definite, as conjugate gradients requires: a spring pushing
+// apart (compressed past its rest length) contributes no stiffness along its axis. A
+// ParticleSpring is registered once per end, a SpringSet spring pulls both; when only one
+// end is pulled, or when the other end cannot move, the other end is treated as fixed for
+// that step.
+// Results do not depend on the number of worker threads.
+class ImplicitSpringSolver
+{
+public:
+	unsigned int MaxIterations = 100;
+	// Stops once the residual is this fraction of the right-hand side
+	float Tolerance = 1e-5f;
+
+	// Adds each spring particle's velocity change, as a force, to store.AccumulatedForces
+	void Apply(ParticleStore& store, const std::vector<ForceRegistry::SpringRegistration>& springs,
+	           const std::list<SpringSet*>& springSets, float time, WorkerPool* workers = nullptr);
+
+	// Call after integration: the integrator moves particles by only half of the velocity
+	// change a force gives (x += v h + a h^2 / 2), backward Euler moves them by all of it
+	void CorrectPositions(ParticleStore& store, float time);
+
+	// Conjugate gradient iterations of the last Apply
+	unsigned int GetIterations() const { return iterations; }
+
+private:
+	struct Block
+	{
+		float m[9] = {}; // Row major
+
+		MyVector operator*(const MyVector& v) const
+		{
+			return MyVector(m[0] * v.x + m[1] * v.y + m[2] * v.z,
+			                m[3] * v.x + m[4] * v.y + m[5] * v.z,
+			                m[6] * v.x + m[7] * v.y + m[8] * v.z);
+		}
+	};
+
+	struct Coupling
+	{
+		unsigned int row, column;
+		Block block;
+	};
+
+	// y = A x, row by row
+	void Multiply(const std::vector<MyVector>& x, std::vector<MyVector>& y, WorkerPool* workers);
+	// Sums in fixed chunks, so the result is the same on any number of threads
+	double Dot(const std::vector<MyVector>& a, const std::vector<MyVector>& b, WorkerPool* workers);
+
+	struct HalfSpring
+	{
+		unsigned int index; // Dense index of the particle pulled
+		ForceGenerator::Spring spring;
+	};
+	std::vector<HalfSpring> halfSprings;
+
+	std::vector<int> nodeOf; // Per dense particle index, its row or -1
+	std::vector<unsigned int> nodeParticle; // Per row, its dense particle index
+
+	std::vector<Block> diagonal;
+	std::vector<Block> preconditioner; // Inverted diagonal blocks
+	std::vector<Coupling> couplings; // Off-diagonal blocks before they are sorted into rows
+	std::vector<Coupling> bucketed;
+	std::vector<unsigned int> bucketStart, bucketEnd;
+	std::vector<unsigned int> rowStart; // Compressed sparse rows of the off-diagonal blocks
+	std::vector<unsigned int> columns;
+	std::vector<Block> blocks;
+
+	std::vector<MyVector> rhs, solution, residual, direction, preconditioned, product;
+	std::vector<double> partialSums;
+	unsigned int iterations = 0;
+};
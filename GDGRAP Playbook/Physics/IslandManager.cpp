@@ -0,0 +1,265 @@
+#include "IslandManager.h"
+
+#include <algorithm>
+
+unsigned int IslandManager::Node(const ParticleStore& store, const PhysicsParticle* p)
+{
+	if (!p || p->GetStore() != &store) return NoNode;
+
+	unsigned int index = store.IndexOf(p->GetHandle());
+	return store.InverseMasses[index] > 0 ? index : NoNode;
+}
+
+void IslandManager::AddEdge(const ParticleStore& store, const PhysicsParticle* a, const PhysicsParticle* b)
+{
+	unsigned int nodeA = Node(store, a);
+	unsigned int nodeB = Node(store, b);
+	if (nodeA == NoNode || nodeB == NoNode) return;
+	if (store.Asleep[nodeA] && store.Asleep[nodeB]) return;
+
+	edges.push_back(Edge{ nodeA, nodeB });
+}
+
+unsigned int IslandManager::Find(unsigned int node)
+{
+	while (parent[node] != node)
+	{
+		parent[node] = parent[parent[node]];
+		node = parent[node];
+	}
+	return node;
+}
+
+bool IslandManager::TopologyCurrent(const ParticleStore& store, const std::list<ParticleLink*>& links,
+                                    const std::list<SpringSet*>& springSets, const ForceRegistry& forces) const
+{
+	if (topologyDirty || topologyStore != &store || topologyLayout != store.LayoutVersion()
+		|| topologyLinkCount != links.size() || topologyRegistry != forces.Version()
+		|| topologySets.size() != springSets.size())
+	{
+		return false;
+	}
+
+	auto recorded = topologySets.begin();
+	for (const SpringSet* springs : springSets)
+	{
+		if (recorded->first != springs || recorded->second != springs->Version()) return false;
+		++recorded;
+	}
+	return true;
+}
+
+void IslandManager::GatherEdges(const ParticleStore& store, const std::list<ParticleLink*>& links,
+                                const std::list<SpringSet*>& springSets, ForceRegistry& forces,
+                                const ContactArena& contacts)
+{
+	// Edges leave out sleeping pairs and immovable particles, which the layout version covers
+	if (!TopologyCurrent(store, links, springSets, forces))
+	{
+		edges.clear();
+		for (const ParticleLink* link : links)
+		{
+			if (!link->IsAsleep()) AddEdge(store, link->particles[0], link->particles[1]);
+		}
+		topologySets.clear();
+		for (const SpringSet* springs : springSets)
+		{
+			for (unsigned int i = 0; i < springs->Size(); i++) AddEdge(store, springs->GetParticle(i, 0), springs->GetParticle(i, 1));
+			topologySets.emplace_back(springs, springs->Version());
+		}
+		for (const ForceRegistry::Connection& connection : forces.GetConnections())
+		{
+			AddEdge(store, connection.particle, connection.other);
+		}
+
+		topologyEdgeCount = edges.size();
+		topologyDirty = false;
+		topologyStore = &store;
+		topologyLayout = store.LayoutVersion();
+		topologyLinkCount = links.size();
+		topologyRegistry = forces.Version();
+	}
+
+	edges.resize(topologyEdgeCount);
+	for (const ParticleContact& contact : contacts)
+	{
+		AddEdge(store, contact.particles[0], contact.particles[1]);
+	}
+}
+
+void IslandManager::Update(ParticleStore& store, const std::list<ParticleLink*>& links,
+                           const std::list<SpringSet*>& springSets, ForceRegistry& forces,
+                           const ContactArena& contacts, float time)
+{
+	// Nothing awake means nothing moved and nothing can wake
+	if (store.AwakeIndices().empty()) return;
+
+	bool gathered = false;
+	if (store.AwakeIndices().size() < store.Size())
+	{
+		GatherEdges(store, links, springSets, forces, contacts);
+		gathered = true;
+
+		// An awake particle touching a sleeping one wakes the sleeping island, and a particle
+		// woken on its own (by a force) brings its island along
+		for (const Edge& edge : edges)
+		{
+			if (store.Asleep[edge.a]) WakeIsland(store, edge.a);
+			else if (store.Asleep[edge.b]) WakeIsland(store, edge.b);
+		}
+		for (unsigned int i : store.AwakeIndices())
+		{
+			if (store.SleepIslands[i] != ParticleStore::NoIsland) WakeIsland(store, i);
+		}
+	}
+
+	if (!Enabled) return;
+
+	const std::vector<unsigned int>& awake = store.AwakeIndices();
+	bool anyRested = false;
+	for (unsigned int i : awake)
+	{
+		const MyVector& v = store.Velocities[i];
+		float energy = 0.5f * (v.x * v.x + v.y * v.y + v.z * v.z);
+		store.SleepTimers[i] = energy < SleepEnergy ? store.SleepTimers[i] + time : 0.0f;
+		anyRested = anyRested || store.SleepTimers[i] >= SleepTime;
+	}
+
+	// Islands are only worth building once some particle has rested long enough to sleep
+	if (!anyRested) return;
+	if (!gathered) GatherEdges(store, links, springSets, forces, contacts);
+
+	if (parent.size() < store.Size())
+	{
+		parent.resize(store.Size());
+		islandRest.resize(store.Size());
+		islandId.resize(store.Size());
+	}
+
+	for (unsigned int i : awake)
+	{
+		parent[i] = i;
+		islandRest[i] = store.SleepTimers[i];
+		islandId[i] = ParticleStore::NoIsland;
+	}
+
+	// Every edge joins two awake particles by now; the lower index becomes the root
+	for (const Edge& edge : edges)
+	{
+		unsigned int rootA = Find(edge.a);
+		unsigned int rootB = Find(edge.b);
+		if (rootA == rootB) continue;
+		if (rootA < rootB) parent[rootB] = rootA;
+		else parent[rootA] = rootB;
+	}
+
+	for (unsigned int i : awake)
+	{
+		unsigned int root = Find(i);
+		islandRest[root] = std::min(islandRest[root], store.SleepTimers[i]);
+	}
+
+	for (unsigned int i : awake)
+	{
+		unsigned int root = Find(i);
+		if (islandRest[root] < SleepTime) continue;
+
+		if (islandId[root] == ParticleStore::NoIsland)
+		{
+			if (freeIslands.empty())
+			{
+				islandId[root] = static_cast<unsigned int>(sleepingIslands.size());
+				sleepingIslands.emplace_back();
+			}
+			else
+			{
+				islandId[root] = freeIslands.back();
+				freeIslands.pop_back();
+			}
+		}
+
+		sleepingIslands[islandId[root]].push_back(store.HandleOf(i));
+		store.SleepIslands[i] = islandId[root];
+		store.SetAsleep(i, true);
+
+		store.Velocities[i] = MyVector(0, 0, 0);
+		store.Accelerations[i] = MyVector(0, 0, 0);
+		store.AccumulatedForces[i] = MyVector(0, 0, 0);
+	}
+}
+
+void IslandManager::WakeIsland(ParticleStore& store, unsigned int index)
+{
+	unsigned int id = store.SleepIslands[index];
+	store.SetAsleep(index, false);
+	store.SleepIslands[index] = ParticleStore::NoIsland;
+	if (id == ParticleStore::NoIsland) return;
+
+	for (ParticleStore::Handle handle : sleepingIslands[id])
+	{
+		// Members may have left the store since, and their handles may have been reused
+		unsigned int member = store.IndexOf(handle);
+		if (member >= store.Size() || store.SleepIslands[member] != id) continue;
+
+		store.SetAsleep(member, false);
+		store.SleepIslands[member] = ParticleStore::NoIsland;
+	}
+
+	sleepingIslands[id].clear();
+	freeIslands.push_back(id);
+}
+
+void IslandManager::WakeAll(ParticleStore& store)
+{
+	for (unsigned int i = 0; i < store.Size(); i++)
+	{
+		store.SetAsleep(i, false);
+		store.SleepIslands[i] = ParticleStore::NoIsland;
+	}
+
+	sleepingIslands.clear();
+	freeIslands.clear();
+}
+
+void IslandManager::Save(SnapshotWriter& out) const
+{
+	out.Write(static_cast<unsigned int>(sleepingIslands.size()));
+	for (const std::vector<ParticleStore::Handle>& island : sleepingIslands) out.WriteArray(island);
+	out.WriteArray(freeIslands);
+}
+
+bool IslandManager::Load(SnapshotReader& in, const ParticleStore& store)
+{
+	unsigned int count = 0;
+	in.Read(count);
+	sleepingIslands.clear();
+	for (unsigned int i = 0; i < count && !in.Failed(); i++)
+	{
+		sleepingIslands.emplace_back();
+		in.ReadArray(sleepingIslands.back());
+	}
+	in.ReadArray(freeIslands);
+	if (in.Failed()) return false;
+
+	// Waking an island indexes the store with its handles and the islands with the store's ids
+	bool valid = true;
+	for (const std::vector<ParticleStore::Handle>& island : sleepingIslands)
+	{
+		for (ParticleStore::Handle handle : island) valid = valid && handle < store.HandleCount();
+	}
+	for (unsigned int id : freeIslands) valid = valid && id < sleepingIslands.size();
+	for (unsigned int id : store.SleepIslands)
+	{
+		valid = valid && (id == ParticleStore::NoIsland || id < sleepingIslands.size());
+	}
+
+	if (!valid) in.Fail();
+	return valid;
+}
+
+void IslandManager::Adopt(IslandManager& loaded)
+{
+	sleepingIslands.swap(loaded.sleepingIslands);
+	freeIslands.swap(loaded.freeIslands);
+	topologyDirty = true;
+}
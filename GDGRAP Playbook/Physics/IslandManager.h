@@ -0,0 +1,91 @@
+#pragma once
+#include <list>
+#include <vector>
+
+#include "ParticleStore.h"
+#include "ParticleLink.h"
+#include "ContactArena.h"
+#include "ForceRegistry.h"
+#include "SpringSet.h"
+#include "Snapshot.h"
+
+// Sleeping for particles at rest.
+// Each substep the awake particles are grouped into islands, connected through links,
+// springs and contacts, and an island falls asleep once all of its particles have stayed
+// below SleepEnergy for SleepTime. Sleeping particles are skipped by force accumulation,
+// integration, link checks and the broadphase, so a settled scene costs next to nothing.
+// A sleeping island wakes as a whole when one of its particles touches an awake particle,
+// is given a force or is woken through PhysicsParticle::Wake.
+// Particles without mass never move and do not join islands.
+class IslandManager
+{
+public:
+	// When false, islands still wake but never fall asleep
+	bool Enabled = true;
+	// Kinetic energy per unit mass, 0.5 v^2, below which a particle counts as resting
+	float SleepEnergy = 0.02f;
+	// Seconds an island has to rest before it falls asleep
+	float SleepTime = 0.5f;
+
+	// Call once per substep, after contacts are resolved
+	void Update(ParticleStore& store, const std::list<ParticleLink*>& links, const std::list<SpringSet*>& springSets,
+	            ForceRegistry& forces, const ContactArena& contacts, float time);
+
+	// Wakes the particle at index together with the island it fell asleep with
+	void WakeIsland(ParticleStore& store, unsigned int index);
+	void WakeAll(ParticleStore& store);
+
+	// The edges of links, springs and force connections are cached between substeps. Spring
+	// sets, the registry and the store report their own changes; links that were replaced
+	// or pointed at other particles have to be reported here.
+	void LinksChanged() { topologyDirty = true; }
+
+	// Snapshot support: the sleeping islands. The settings above are not saved. Load reads
+	// into an empty manager and checks the islands against the store loaded with them;
+	// Adopt takes over a loaded manager's islands.
+	void Save(SnapshotWriter& out) const;
+	bool Load(SnapshotReader& in, const ParticleStore& store);
+	void Adopt(IslandManager& loaded);
+
+	unsigned int SleepingIslandCount() const
+	{
+		return static_cast<unsigned int>(sleepingIslands.size() - freeIslands.size());
+	}
+
+private:
+	// Dense index of p when it is a movable particle of store, NoNode otherwise
+	static unsigned int Node(const ParticleStore& store, const PhysicsParticle* p);
+	void AddEdge(const ParticleStore& store, const PhysicsParticle* a, const PhysicsParticle* b);
+	bool TopologyCurrent(const ParticleStore& store, const std::list<ParticleLink*>& links,
+	                     const std::list<SpringSet*>& springSets, const ForceRegistry& forces) const;
+	void GatherEdges(const ParticleStore& store, const std::list<ParticleLink*>& links,
+	                 const std::list<SpringSet*>& springSets, ForceRegistry& forces, const ContactArena& contacts);
+	unsigned int Find(unsigned int node);
+
+	static constexpr unsigned int NoNode = ~0u;
+
+	struct Edge
+	{
+		unsigned int a, b;
+	};
+	// The first topologyEdgeCount edges come from links, springs and force connections and
+	// are kept while none of them and the store's layout change; each substep's contact
+	// edges follow them
+	std::vector<Edge> edges;
+	size_t topologyEdgeCount = 0;
+	bool topologyDirty = true;
+	const ParticleStore* topologyStore = nullptr;
+	unsigned int topologyLayout = 0;
+	size_t topologyLinkCount = 0;
+	unsigned int topologyRegistry = 0;
+	std::vector<std::pair<const SpringSet*, unsigned int>> topologySets; // Each set and its version
+
+	// Union-find over dense indices; only entries of awake particles are meaningful
+	std::vector<unsigned int> parent;
+	std::vector<float> islandRest; // Shortest sleep timer of each island, by root
+	std::vector<unsigned int> islandId; // Sleeping island assigned to each root
+
+	// Handles of the particles of each sleeping island
+	std::vector<std::vector<ParticleStore::Handle>> sleepingIslands;
+	std::vector<unsigned int> freeIslands;
+};
@@ -1,47 +1,166 @@
 #pragma once
+#include <cmath>
+#include <limits>
 #include <glm/vec3.hpp>
 
+#include "Simd.h"
+
+// Header-only so every operation inlines into the loops that use it. None of the helpers
+// use hardware fused multiply-adds, so results stay the same on every compiler and CPU,
+// except for the Fast* helpers: those trade exactness and portability for speed and are
+// for code that needs neither, never for the simulation step.
 class MyVector
 {
 public:
 	float x, y, z;
 
-	MyVector();
-	MyVector(float x, float y, float z);
+	constexpr MyVector() : x(0.0f), y(0.0f), z(0.0f)
+	{
+	}
 
-	float Magnitude() const;
+	constexpr MyVector(float x, float y, float z) : x(x), y(y), z(z)
+	{
+	}
 
-	MyVector Direction() const;
+	float Magnitude() const { return std::sqrt(SquareMagnitude()); }
 
-	MyVector operator+(const MyVector& other) const;
+	// Magnitude squared, without the square root; enough for comparing lengths
+	constexpr float SquareMagnitude() const { return x * x + y * y + z * z; }
 
-	MyVector operator-(const MyVector& other) const;
+	// The unit vector pointing the same way, or zero for the zero vector
+	MyVector Direction() const { return Direction(Magnitude()); }
 
-	MyVector operator*(float scalar) const;
+	// Direction() for a caller that already knows Magnitude()
+	MyVector Direction(float mag) const
+	{
+		if (mag == 0.0f) return MyVector(0.0f, 0.0f, 0.0f);
+		return MyVector(x / mag, y / mag, z / mag);
+	}
 
-	MyVector ComponentProduct(const MyVector& other) const;
+	// Returns Magnitude() and sets direction to Direction(), taking the square root once
+	float MagnitudeAndDirection(MyVector& direction) const
+	{
+		float mag = Magnitude();
+		direction = Direction(mag);
+		return mag;
+	}
 
-	float ScalarProduct(const MyVector& other) const;
+	// 1 / sqrt(square) for square >= FLT_MIN: the SSE estimate refined by one Newton-Raphson
+	// step, good to about 2 ulp. The estimate is CPU specific, so results can differ between
+	// CPU vendors in the last bits. Without SSE this is the exact division.
+	static float ReciprocalSqrt(float square)
+	{
+#if PHYSICS_SSE
+		float estimate = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(square)));
+		return estimate * (1.5f - 0.5f * square * estimate * estimate);
+#else
+		return 1.0f / std::sqrt(square);
+#endif
+	}
 
-	MyVector VectorProduct(const MyVector& other) const;
+	// Direction() through ReciprocalSqrt, replacing the square root and three divides with
+	// multiplies; zero for vectors too short to normalize. Opt-in only: not exact, and not
+	// the same on every CPU.
+	MyVector FastDirection() const
+	{
+		MyVector direction;
+		FastMagnitudeAndDirection(direction);
+		return direction;
+	}
 
-	MyVector& operator*=(float scalar);
+	// MagnitudeAndDirection() through ReciprocalSqrt
+	float FastMagnitudeAndDirection(MyVector& direction) const
+	{
+		float square = SquareMagnitude();
+		if (!(square >= std::numeric_limits<float>::min()))
+		{
+			direction = MyVector(0.0f, 0.0f, 0.0f);
+			return std::sqrt(square);
+		}
+
+		float inverse = ReciprocalSqrt(square);
+		direction = *this * inverse;
+		return square * inverse;
+	}
+
+	// Older names of Magnitude and Direction
+	float magnitude() const { return Magnitude(); }
+	MyVector normalize() const { return Direction(); }
+
+	constexpr MyVector operator+(const MyVector& other) const
+	{
+		return MyVector(x + other.x, y + other.y, z + other.z);
+	}
+
+	constexpr MyVector operator-(const MyVector& other) const
+	{
+		return MyVector(x - other.x, y - other.y, z - other.z);
+	}
 
-	friend MyVector operator*(float scalar, const MyVector& vector);
+	constexpr MyVector operator*(float scalar) const
+	{
+		return MyVector(x * scalar, y * scalar, z * scalar);
+	}
+
+	constexpr MyVector ComponentProduct(const MyVector& other) const
+	{
+		return MyVector(x * other.x, y * other.y, z * other.z);
+	}
+
+	constexpr float ScalarProduct(const MyVector& other) const
+	{
+		return x * other.x + y * other.y + z * other.z;
+	}
+
+	constexpr MyVector VectorProduct(const MyVector& other) const
+	{
+		return MyVector(
+			y * other.z - z * other.y,
+			z * other.x - x * other.z,
+			x * other.y - y * other.x
+		);
+	}
+
+	constexpr MyVector& operator*=(float scalar)
+	{
+		x *= scalar;
+		y *= scalar;
+		z *= scalar;
+		return *this;
+	}
+
+	friend constexpr MyVector operator*(float scalar, const MyVector& vector)
+	{
+		return MyVector(vector.x * scalar, vector.y * scalar, vector.z * scalar);
+	}
 
 	operator glm::vec3() const
 	{
 		return glm::vec3(x, y, z);
 	}
 
-	MyVector& operator+=(const MyVector& force);
-	float magnitude() const;
-	MyVector normalize() const;
+	constexpr MyVector& operator+=(const MyVector& force)
+	{
+		x += force.x;
+		y += force.y;
+		z += force.z;
+		return *this;
+	}
 
-	MyVector& operator-=(const MyVector& other) {
+	constexpr MyVector& operator-=(const MyVector& other)
+	{
 		x -= other.x;
 		y -= other.y;
 		z -= other.z;
 		return *this;
 	}
+
+	// Multiply-add: *this += other * scale without the temporary
+	constexpr MyVector& AddScaled(const MyVector& other, float scale)
+	{
+		x += other.x * scale;
+		y += other.y * scale;
+		z += other.z * scale;
+		return *this;
+	}
 };
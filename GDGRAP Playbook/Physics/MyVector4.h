@@ -0,0 +1,109 @@
+#pragma once
+#include <cmath>
+
+#include "MyVector.h"
+#include "Simd.h"
+
+// MyVector padded to four 16-byte aligned lanes, so each operation is one SSE instruction
+// on all of x, y and z. w stays 0. Meant for temporaries in hot math: the ParticleStore
+// arrays keep MyVector, which packs 25% tighter. SSE rounds like scalar float math and the
+// sums run in MyVector's order, so results match MyVector's bit for bit. Without SSE the
+// lanes are computed one by one.
+struct alignas(16) MyVector4
+{
+	float x, y, z, w;
+
+	constexpr MyVector4() : x(0.0f), y(0.0f), z(0.0f), w(0.0f)
+	{
+	}
+
+	constexpr MyVector4(float x, float y, float z) : x(x), y(y), z(z), w(0.0f)
+	{
+	}
+
+	constexpr explicit MyVector4(const MyVector& v) : x(v.x), y(v.y), z(v.z), w(0.0f)
+	{
+	}
+
+	constexpr MyVector ToVector() const { return MyVector(x, y, z); }
+
+#if PHYSICS_SSE
+	__m128 Load() const { return _mm_load_ps(&x); }
+
+	static MyVector4 From(__m128 lanes)
+	{
+		MyVector4 result;
+		_mm_store_ps(&result.x, lanes);
+		return result;
+	}
+
+	MyVector4 operator+(const MyVector4& other) const { return From(_mm_add_ps(Load(), other.Load())); }
+	MyVector4 operator-(const MyVector4& other) const { return From(_mm_sub_ps(Load(), other.Load())); }
+	MyVector4 operator*(float scalar) const { return From(_mm_mul_ps(Load(), _mm_set1_ps(scalar))); }
+	MyVector4 ComponentProduct(const MyVector4& other) const { return From(_mm_mul_ps(Load(), other.Load())); }
+
+	float ScalarProduct(const MyVector4& other) const
+	{
+		// (x + y) + z, as MyVector sums it
+		__m128 products = _mm_mul_ps(Load(), other.Load());
+		__m128 sum = _mm_add_ss(products, _mm_shuffle_ps(products, products, _MM_SHUFFLE(1, 1, 1, 1)));
+		return _mm_cvtss_f32(_mm_add_ss(sum, _mm_movehl_ps(products, products)));
+	}
+
+	MyVector4 VectorProduct(const MyVector4& other) const
+	{
+		__m128 a = Load(), b = other.Load();
+		__m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 aZXY = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+		__m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 bZXY = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+		return From(_mm_sub_ps(_mm_mul_ps(aYZX, bZXY), _mm_mul_ps(aZXY, bYZX)));
+	}
+
+	MyVector4& AddScaled(const MyVector4& other, float scale)
+	{
+		_mm_store_ps(&x, _mm_add_ps(Load(), _mm_mul_ps(other.Load(), _mm_set1_ps(scale))));
+		return *this;
+	}
+
+	MyVector4 Direction() const
+	{
+		float mag = Magnitude();
+		if (mag == 0.0f) return MyVector4();
+		return From(_mm_div_ps(Load(), _mm_set1_ps(mag)));
+	}
+#else
+	MyVector4 operator+(const MyVector4& other) const { return MyVector4(x + other.x, y + other.y, z + other.z); }
+	MyVector4 operator-(const MyVector4& other) const { return MyVector4(x - other.x, y - other.y, z - other.z); }
+	MyVector4 operator*(float scalar) const { return MyVector4(x * scalar, y * scalar, z * scalar); }
+	MyVector4 ComponentProduct(const MyVector4& other) const { return MyVector4(x * other.x, y * other.y, z * other.z); }
+	float ScalarProduct(const MyVector4& other) const { return x * other.x + y * other.y + z * other.z; }
+
+	MyVector4 VectorProduct(const MyVector4& other) const
+	{
+		return MyVector4(y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x);
+	}
+
+	MyVector4& AddScaled(const MyVector4& other, float scale)
+	{
+		x += other.x * scale;
+		y += other.y * scale;
+		z += other.z * scale;
+		return *this;
+	}
+
+	MyVector4 Direction() const
+	{
+		float mag = Magnitude();
+		if (mag == 0.0f) return MyVector4();
+		return MyVector4(x / mag, y / mag, z / mag);
+	}
+#endif
+
+	float SquareMagnitude() const { return ScalarProduct(*this); }
+	float Magnitude() const { return std::sqrt(SquareMagnitude()); }
+
+	MyVector4& operator+=(const MyVector4& other) { return *this = *this + other; }
+	MyVector4& operator-=(const MyVector4& other) { return *this = *this - other; }
+	MyVector4& operator*=(float scalar) { return *this = *this * scalar; }
+};
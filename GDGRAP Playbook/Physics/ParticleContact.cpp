@@ -10,9 +10,9 @@ void ParticleContact::Resolve(float time)
 
 float ParticleContact::GetSeparatingSpeed()
 {
-	MyVector velocity = particles[0]->Velocity;
+	MyVector velocity = particles[0]->Velocity();
 
-	if (particles[1]) velocity -= particles[1]->Velocity;
+	if (particles[1]) velocity -= particles[1]->Velocity();
 	return velocity.ScalarProduct(contactNormal);
 }
 
@@ -25,21 +25,21 @@ void ParticleContact::ResolveVelocity(float time)
 	float newSS = -restitution * separatingSpeed;
 	float deltaSpeed = newSS - separatingSpeed;
 
-	float totalMass = static_cast<float>(1) / particles[0]->mass;
-	if (particles[1]) totalMass += static_cast<float>(1) / particles[1]->mass;
+	float totalMass = particles[0]->GetInverseMass();
+	if (particles[1]) totalMass += particles[1]->GetInverseMass();
 
 	if (totalMass <= 0) return;
 
 	float impulseMag = deltaSpeed / totalMass;
 	MyVector Impulse = contactNormal * impulseMag;
 
-	MyVector v_A = Impulse * (static_cast<float>(1) / particles[0]->mass);
-	particles[0]->Velocity = particles[0]->Velocity + v_A;
+	MyVector v_A = Impulse * particles[0]->GetInverseMass();
+	particles[0]->Velocity() = particles[0]->Velocity() + v_A;
 
 	if (particles[1])
 	{
-		MyVector v_B = Impulse * (static_cast<float>(1) / particles[1]->mass);
-		particles[1]->Velocity = particles[1]->Velocity - v_B;
+		MyVector v_B = Impulse * particles[1]->GetInverseMass();
+		particles[1]->Velocity() = particles[1]->Velocity() - v_B;
 	}
 }
 
@@ -51,19 +51,19 @@ void ParticleContact::ResolveInterpenetration(float time)
 	if (!particles[1])
 	{
 		// Move the particle back along the contact normal by the penetration depth
-		particles[0]->Position += contactNormal * depth;
+		particles[0]->Position() += contactNormal * depth;
 	}
 	else
 	{
 		// Standard two-particle resolution
-		float totalMass = 1.0f / particles[0]->mass + 1.0f / particles[1]->mass;
+		float totalMass = particles[0]->GetInverseMass() + particles[1]->GetInverseMass();
 		if (totalMass <= 0) return;
 
 		float movePerMass = depth / totalMass;
 		MyVector move = contactNormal * movePerMass;
 
-		particles[0]->Position += move * (1.0f / particles[0]->mass);
-		particles[1]->Position -= move * (1.0f / particles[1]->mass);
+		particles[0]->Position() += move * particles[0]->GetInverseMass();
+		particles[1]->Position() -= move * particles[1]->GetInverseMass();
 	}
 
 	depth = 0;
@@ -7,19 +7,20 @@
 class ParticleContact
 {
 public:
-	PhysicsParticle* particles[2];
-	float restitution;
+	PhysicsParticle* particles[2] = { nullptr, nullptr };
+	float restitution = 0;
 	MyVector contactNormal;
 	void Resolve(float time);
 
 	float GetSeparatingSpeed();
 
-	float depth;
+	float depth = 0;
+
+	// Moves the particles apart by depth, in inverse proportion to their masses
+	void ResolveInterpenetration(float time);
 
 protected:
 	void ResolveVelocity(float time);
-
-	void ResolveInterpenetration(float time);
 };
 
 #endif
@@ -0,0 +1,264 @@
+#include "ParticleIntegrator.h"
+
+#include <cmath>
+
+#include "Simd.h"
+#include "WorkerPool.h"
+
+#if PHYSICS_SIMD && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static_assert(sizeof(MyVector) == 3 * sizeof(float), "MyVector arrays are integrated as flat float arrays");
+
+namespace
+{
+	// Longest run integrated as one job
+	const unsigned int MaxRunLength = 4096;
+
+	struct Arrays
+	{
+		float* position;
+		float* velocity;
+		float* acceleration;
+		float* force;
+		const float* inverseMass;
+		const float* damping; // Per-particle factors, or nullptr to use sharedDamping
+		float sharedDamping;
+	};
+
+	void IntegrateScalar(const Arrays& arr, float time, unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			float invMass = arr.inverseMass[i];
+			float damping = arr.damping ? arr.damping[i] : arr.sharedDamping;
+
+			for (unsigned int k = 3 * i; k < 3 * i + 3; k++)
+			{
+				arr.position[k] = arr.position[k] + arr.velocity[k] * time + 0.5f * (arr.acceleration[k] * time * time);
+
+				float acceleration = arr.acceleration[k] + arr.force[k] * invMass;
+				arr.velocity[k] = (arr.velocity[k] + acceleration * time) * damping;
+
+				arr.acceleration[k] = 0;
+				arr.force[k] = 0;
+			}
+		}
+	}
+
+#if PHYSICS_SIMD
+	PHYSICS_TARGET("sse2")
+	void IntegrateSSE(const Arrays& arr, float time, unsigned int begin, unsigned int end)
+	{
+		const __m128 t = _mm_set1_ps(time);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 shared = _mm_set1_ps(arr.sharedDamping);
+
+		unsigned int i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			// Spread 4 per-particle scalars over the 12 xyz lanes of 4 particles
+			__m128 m = _mm_loadu_ps(arr.inverseMass + i);
+			__m128 invMass[3] = {
+				_mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 0, 0)),
+				_mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 1, 1)),
+				_mm_shuffle_ps(m, m, _MM_SHUFFLE(3, 3, 3, 2))
+			};
+
+			__m128 damping[3] = { shared, shared, shared };
+			if (arr.damping)
+			{
+				__m128 d = _mm_loadu_ps(arr.damping + i);
+				damping[0] = _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 0, 0, 0));
+				damping[1] = _mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 2, 1, 1));
+				damping[2] = _mm_shuffle_ps(d, d, _MM_SHUFFLE(3, 3, 3, 2));
+			}
+
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				unsigned int offset = 3 * i + 4 * k;
+				__m128 p = _mm_loadu_ps(arr.position + offset);
+				__m128 v = _mm_loadu_ps(arr.velocity + offset);
+				__m128 a = _mm_loadu_ps(arr.acceleration + offset);
+				__m128 f = _mm_loadu_ps(arr.force + offset);
+
+				p = _mm_add_ps(_mm_add_ps(p, _mm_mul_ps(v, t)), _mm_mul_ps(half, _mm_mul_ps(_mm_mul_ps(a, t), t)));
+				a = _mm_add_ps(a, _mm_mul_ps(f, invMass[k]));
+				v = _mm_mul_ps(_mm_add_ps(v, _mm_mul_ps(a, t)), damping[k]);
+
+				_mm_storeu_ps(arr.position + offset, p);
+				_mm_storeu_ps(arr.velocity + offset, v);
+				_mm_storeu_ps(arr.acceleration + offset, zero);
+				_mm_storeu_ps(arr.force + offset, zero);
+			}
+		}
+
+		IntegrateScalar(arr, time, i, end);
+	}
+
+	PHYSICS_TARGET("avx2")
+	void IntegrateAVX2(const Arrays& arr, float time, unsigned int begin, unsigned int end)
+	{
+		const __m256 t = _mm256_set1_ps(time);
+		const __m256 half = _mm256_set1_ps(0.5f);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 shared = _mm256_set1_ps(arr.sharedDamping);
+
+		// Spread 8 per-particle scalars over the 24 xyz lanes of 8 particles
+		const __m256i spread[3] = {
+			_mm256_setr_epi32(0, 0, 0, 1, 1, 1, 2, 2),
+			_mm256_setr_epi32(2, 3, 3, 3, 4, 4, 4, 5),
+			_mm256_setr_epi32(5, 5, 6, 6, 6, 7, 7, 7)
+		};
+
+		unsigned int i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256 m = _mm256_loadu_ps(arr.inverseMass + i);
+			__m256 d = arr.damping ? _mm256_loadu_ps(arr.damping + i) : shared;
+
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				__m256 invMass = _mm256_permutevar8x32_ps(m, spread[k]);
+				__m256 damping = arr.damping ? _mm256_permutevar8x32_ps(d, spread[k]) : shared;
+
+				unsigned int offset = 3 * i + 8 * k;
+				__m256 p = _mm256_loadu_ps(arr.position + offset);
+				__m256 v = _mm256_loadu_ps(arr.velocity + offset);
+				__m256 a = _mm256_loadu_ps(arr.acceleration + offset);
+				__m256 f = _mm256_loadu_ps(arr.force + offset);
+
+				p = _mm256_add_ps(_mm256_add_ps(p, _mm256_mul_ps(v, t)), _mm256_mul_ps(half, _mm256_mul_ps(_mm256_mul_ps(a, t), t)));
+				a = _mm256_add_ps(a, _mm256_mul_ps(f, invMass));
+				v = _mm256_mul_ps(_mm256_add_ps(v, _mm256_mul_ps(a, t)), damping);
+
+				_mm256_storeu_ps(arr.position + offset, p);
+				_mm256_storeu_ps(arr.velocity + offset, v);
+				_mm256_storeu_ps(arr.acceleration + offset, zero);
+				_mm256_storeu_ps(arr.force + offset, zero);
+			}
+		}
+
+		IntegrateSSE(arr, time, i, end);
+	}
+#endif
+}
+
+ParticleIntegrator::ParticleIntegrator() : kernel(BestAvailable())
+{
+}
+
+ParticleIntegrator::Kernel ParticleIntegrator::BestAvailable()
+{
+#if PHYSICS_SIMD
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] >= 7)
+	{
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		__cpuidex(info, 7, 0);
+		bool avx2 = (info[1] & (1 << 5)) != 0;
+		if (osxsave && avx && avx2 && (_xgetbv(0) & 6) == 6) return AVX2;
+	}
+	return SSE;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return AVX2;
+	if (__builtin_cpu_supports("sse2")) return SSE;
+#endif
+#endif
+	return Scalar;
+}
+
+void ParticleIntegrator::SetKernel(Kernel toUse)
+{
+	Kernel best = BestAvailable();
+	kernel = toUse <= best ? toUse : best;
+}
+
+void ParticleIntegrator::Integrate(ParticleStore& store, float time, WorkerPool* workers)
+{
+	const std::vector<unsigned int>& awake = store.AwakeIndices();
+	if (awake.empty()) return;
+
+	// Sleeping particles are left out by integrating each run of consecutive awake indices.
+	// Particles are independent, so long runs are cut into pieces for the workers.
+	runs.clear();
+	for (unsigned int i : awake)
+	{
+		if (!runs.empty() && runs.back().end == i && runs.back().end - runs.back().begin < MaxRunLength) runs.back().end++;
+		else runs.push_back(Run{ i, i + 1 });
+	}
+
+	Arrays arr;
+	arr.position = &store.Positions[0].x;
+	arr.velocity = &store.Velocities[0].x;
+	arr.acceleration = &store.Accelerations[0].x;
+	arr.force = &store.AccumulatedForces[0].x;
+	arr.inverseMass = store.InverseMasses.data();
+
+	// Hoist powf out of the loop when every particle shares one damping value
+	const float firstDamping = store.Dampings[awake[0]];
+	bool shared = true;
+	for (unsigned int i : awake)
+	{
+		shared = store.Dampings[i] == firstDamping;
+		if (!shared) break;
+	}
+
+	if (shared)
+	{
+		arr.damping = nullptr;
+		arr.sharedDamping = powf(firstDamping, time);
+	}
+	else
+	{
+		// Runs of equal damping (particles added together) reuse the previous factor
+		dampingFactors.resize(store.Size());
+		for (const Run& run : runs)
+		{
+			dampingFactors[run.begin] = powf(store.Dampings[run.begin], time);
+			for (unsigned int i = run.begin + 1; i < run.end; i++)
+			{
+				dampingFactors[i] = store.Dampings[i] == store.Dampings[i - 1]
+					                    ? dampingFactors[i - 1]
+					                    : powf(store.Dampings[i], time);
+			}
+		}
+
+		arr.damping = dampingFactors.data();
+		arr.sharedDamping = 1.0f;
+	}
+
+	const Kernel selected = kernel;
+	auto integrateRuns = [this, &arr, time, selected](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int r = begin; r < end; r++)
+		{
+			const Run& run = runs[r];
+			switch (selected)
+			{
+#if PHYSICS_SIMD
+			case AVX2:
+				IntegrateAVX2(arr, time, run.begin, run.end);
+				break;
+			case SSE:
+				IntegrateSSE(arr, time, run.begin, run.end);
+				break;
+#endif
+			default:
+				IntegrateScalar(arr, time, run.begin, run.end);
+				break;
+			}
+		}
+	};
+
+	const unsigned int runCount = static_cast<unsigned int>(runs.size());
+	if (workers) workers->ParallelFor(runCount, 1, integrateRuns);
+	else integrateRuns(0, runCount);
+}
@@ -0,0 +1,40 @@
+#include "ParticleLink.h"
+
+#include "MyVector.h"
+
+
+	float ParticleLink::currentLength() 
+	{
+		MyVector ret = particles[0]->Position() - particles[1]->Position();
+		return ret.magnitude();
+	}
+
+	void ParticleLink::MoveApart(const MyVector& axis, float amount)
+	{
+		float inverseMass0 = particles[0]->GetInverseMass();
+		float inverseMass1 = particles[1]->GetInverseMass();
+		float totalInverseMass = inverseMass0 + inverseMass1;
+		if (totalInverseMass <= 0.0f) return;
+
+		MyVector move = axis * (amount / totalInverseMass);
+		particles[0]->Position() += move * inverseMass0;
+		particles[1]->Position() -= move * inverseMass1;
+	}
+
+	bool ParticleLink::IsAsleep() const
+	{
+		if (!particles[0] && !particles[1]) return false;
+		return (!particles[0] || particles[0]->IsAsleep()) && (!particles[1] || particles[1]->IsAsleep());
+	}
+
+	void ParticleLink::Save(SnapshotWriter& out) const
+	{
+		out.WritePointer(particles[0]);
+		out.WritePointer(particles[1]);
+	}
+
+	void ParticleLink::Load(SnapshotReader& in)
+	{
+		in.ReadPointer(particles[0]);
+		in.ReadPointer(particles[1]);
+	}
@@ -0,0 +1,34 @@
+#pragma once
+#include "PhysicsParticle.h"
+#include "ParticleContact.h"
+#include "ContactArena.h"
+#include "Snapshot.h"
+
+	class ParticleLink {
+	public:
+		PhysicsParticle* particles[2] = { nullptr, nullptr }; // Initialize particles to nullptr
+		virtual ~ParticleLink() = default;
+		// Writes the link's contact, if any, into contacts and returns it
+		virtual ParticleContact* GetContact(ContactArena& contacts) { return nullptr; };
+		// True when every particle the link holds is asleep; such links are not checked
+		virtual bool IsAsleep() const;
+
+		// Position-based stepping (PhysicsWorld::PositionBased). Links that can project
+		// themselves get StartProjection once per step and then Project on every solver
+		// iteration, moving their particles straight onto the constraint, instead of
+		// producing contacts. time is the step length.
+		virtual bool CanProject() const { return false; }
+		virtual void StartProjection() {}
+		virtual void Project(float time) {}
+
+		// Snapshot support: the linked particles and the link's parameters
+		virtual void Save(SnapshotWriter& out) const;
+		virtual void Load(SnapshotReader& in);
+
+	protected:
+		float currentLength();
+
+		// Moves the particles along axis, the unit vector from particles[1] to particles[0], in
+		// proportion to their inverse masses so that their distance grows by amount
+		void MoveApart(const MyVector& axis, float amount);
+		};
@@ -0,0 +1,287 @@
+#include "ParticleStore.h"
+
+#include <algorithm>
+
+#include "PhysicsParticle.h"
+
+
+ParticleStore::Handle ParticleStore::Allocate(PhysicsParticle* owner, const ParticleState& state)
+{
+	Handle handle;
+	if (!freeHandles.empty())
+	{
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else
+	{
+		handle = static_cast<Handle>(slots.size());
+		slots.push_back(0);
+	}
+
+	slots[handle] = Size();
+	handles.push_back(handle);
+
+	Positions.push_back(state.Position);
+	PreviousPositions.push_back(state.Position);
+	Velocities.push_back(state.Velocity);
+	Accelerations.push_back(state.Acceleration);
+	AccumulatedForces.push_back(state.AccumulatedForce);
+	Masses.push_back(state.Mass);
+	InverseMasses.push_back(state.InverseMass);
+	Dampings.push_back(state.Damping);
+	Radii.push_back(state.Radius);
+	Destroyed.push_back(state.Destroyed ? 1 : 0);
+	Owners.push_back(owner);
+
+	// Particles always enter a store awake
+	Asleep.push_back(0);
+	SleepTimers.push_back(0);
+	SleepIslands.push_back(NoIsland);
+
+	awakeDirty = true;
+	layoutVersion++;
+	return handle;
+}
+
+void ParticleStore::Release(Handle handle)
+{
+	unsigned int hole = slots[handle];
+	unsigned int last = Size() - 1;
+
+	// Keep the arrays dense by moving the last particle into the freed slot
+	if (hole != last)
+	{
+		Positions[hole] = Positions[last];
+		PreviousPositions[hole] = PreviousPositions[last];
+		Velocities[hole] = Velocities[last];
+		Accelerations[hole] = Accelerations[last];
+		AccumulatedForces[hole] = AccumulatedForces[last];
+		Masses[hole] = Masses[last];
+		InverseMasses[hole] = InverseMasses[last];
+		Dampings[hole] = Dampings[last];
+		Radii[hole] = Radii[last];
+		Destroyed[hole] = Destroyed[last];
+		Owners[hole] = Owners[last];
+		Asleep[hole] = Asleep[last];
+		SleepTimers[hole] = SleepTimers[last];
+		SleepIslands[hole] = SleepIslands[last];
+
+		handles[hole] = handles[last];
+		slots[handles[hole]] = hole;
+	}
+
+	Positions.pop_back();
+	PreviousPositions.pop_back();
+	Velocities.pop_back();
+	Accelerations.pop_back();
+	AccumulatedForces.pop_back();
+	Masses.pop_back();
+	InverseMasses.pop_back();
+	Dampings.pop_back();
+	Radii.pop_back();
+	Destroyed.pop_back();
+	Owners.pop_back();
+	Asleep.pop_back();
+	SleepTimers.pop_back();
+	SleepIslands.pop_back();
+	handles.pop_back();
+
+	slots[handle] = ~0u;
+	freeHandles.push_back(handle);
+	awakeDirty = true;
+	layoutVersion++;
+}
+
+ParticleState ParticleStore::Read(Handle handle) const
+{
+	unsigned int i = slots[handle];
+
+	ParticleState state;
+	state.Position = Positions[i];
+	state.Velocity = Velocities[i];
+	state.Acceleration = Accelerations[i];
+	state.AccumulatedForce = AccumulatedForces[i];
+	state.Mass = Masses[i];
+	state.InverseMass = InverseMasses[i];
+	state.Damping = Dampings[i];
+	state.Radius = Radii[i];
+	state.Destroyed = Destroyed[i] != 0;
+	return state;
+}
+
+void ParticleStore::Write(Handle handle, const ParticleState& state)
+{
+	unsigned int i = slots[handle];
+	if (Asleep[i] || (InverseMasses[i] > 0) != (state.InverseMass > 0)) layoutVersion++;
+
+	Positions[i] = state.Position;
+	PreviousPositions[i] = state.Position; // Written state is a jump, not motion to blend
+	Velocities[i] = state.Velocity;
+	Accelerations[i] = state.Acceleration;
+	AccumulatedForces[i] = state.AccumulatedForce;
+	Masses[i] = state.Mass;
+	InverseMasses[i] = state.InverseMass;
+	Dampings[i] = state.Damping;
+	Radii[i] = state.Radius;
+	Destroyed[i] = state.Destroyed ? 1 : 0;
+}
+
+void ParticleStore::SetMass(unsigned int index, float mass, float inverseMass)
+{
+	if ((InverseMasses[index] > 0) != (inverseMass > 0)) layoutVersion++;
+
+	Masses[index] = mass;
+	InverseMasses[index] = inverseMass;
+}
+
+void ParticleStore::SetRadius(unsigned int index, float radius)
+{
+	if (Radii[index] == radius) return;
+
+	Radii[index] = radius;
+	if (Asleep[index]) layoutVersion++;
+}
+
+void ParticleStore::SetAsleep(unsigned int index, bool asleep)
+{
+	if ((Asleep[index] != 0) == asleep) return;
+
+	Asleep[index] = asleep ? 1 : 0;
+	if (asleep) PreviousPositions[index] = Positions[index];
+	else SleepTimers[index] = 0;
+
+	awakeDirty = true;
+	layoutVersion++;
+}
+
+const std::vector<unsigned int>& ParticleStore::AwakeIndices() const
+{
+	if (awakeDirty)
+	{
+		awake.clear();
+		for (unsigned int i = 0; i < Size(); i++)
+		{
+			if (!Asleep[i]) awake.push_back(i);
+		}
+		awakeDirty = false;
+	}
+	return awake;
+}
+
+void ParticleStore::Save(SnapshotWriter& out) const
+{
+	out.WriteArray(Owners);
+	out.WriteArray(slots);
+	out.WriteArray(handles);
+	out.WriteArray(freeHandles);
+
+	out.WriteArray(Positions);
+	out.WriteArray(PreviousPositions);
+	out.WriteArray(Velocities);
+	out.WriteArray(Accelerations);
+	out.WriteArray(AccumulatedForces);
+	out.WriteArray(Masses);
+	out.WriteArray(InverseMasses);
+	out.WriteArray(Dampings);
+	out.WriteArray(Radii);
+	out.WriteArray(Destroyed);
+	out.WriteArray(Asleep);
+	out.WriteArray(SleepTimers);
+	out.WriteArray(SleepIslands);
+}
+
+bool ParticleStore::Load(SnapshotReader& in)
+{
+	in.ReadArray(Owners);
+	in.ReadArray(slots);
+	in.ReadArray(handles);
+	in.ReadArray(freeHandles);
+
+	in.ReadArray(Positions);
+	in.ReadArray(PreviousPositions);
+	in.ReadArray(Velocities);
+	in.ReadArray(Accelerations);
+	in.ReadArray(AccumulatedForces);
+	in.ReadArray(Masses);
+	in.ReadArray(InverseMasses);
+	in.ReadArray(Dampings);
+	in.ReadArray(Radii);
+	in.ReadArray(Destroyed);
+	in.ReadArray(Asleep);
+	in.ReadArray(SleepTimers);
+	in.ReadArray(SleepIslands);
+	awakeDirty = true;
+	if (in.Failed()) return false;
+
+	const size_t count = Owners.size();
+	if (handles.size() != count || Positions.size() != count || PreviousPositions.size() != count ||
+		Velocities.size() != count || Accelerations.size() != count || AccumulatedForces.size() != count ||
+		Masses.size() != count || InverseMasses.size() != count || Dampings.size() != count ||
+		Radii.size() != count || Destroyed.size() != count || Asleep.size() != count ||
+		SleepTimers.size() != count || SleepIslands.size() != count)
+	{
+		in.Fail();
+		return false;
+	}
+
+	// Every saved particle must still exist, once, and sit where its handle says
+	std::vector<PhysicsParticle*> sorted(Owners);
+	std::sort(sorted.begin(), sorted.end());
+	bool valid = std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end();
+	for (unsigned int i = 0; valid && i < count; i++)
+	{
+		valid = Owners[i] && in.IsKnown(Owners[i]) && handles[i] < slots.size() && slots[handles[i]] == i;
+	}
+	for (unsigned int i = 0; valid && i < freeHandles.size(); i++)
+	{
+		valid = freeHandles[i] < slots.size() && slots[freeHandles[i]] >= count;
+	}
+
+	if (!valid) in.Fail();
+	return valid;
+}
+
+void ParticleStore::Adopt(ParticleStore& loaded)
+{
+	// Particles the snapshot does not know go back to holding their own state
+	if (Owners != loaded.Owners)
+	{
+		std::vector<PhysicsParticle*> sorted(loaded.Owners);
+		std::sort(sorted.begin(), sorted.end());
+		std::vector<PhysicsParticle*> extra;
+		for (PhysicsParticle* owner : Owners)
+		{
+			if (!std::binary_search(sorted.begin(), sorted.end(), owner)) extra.push_back(owner);
+		}
+		for (PhysicsParticle* owner : extra) owner->Bind(nullptr);
+	}
+
+	Owners.swap(loaded.Owners);
+	slots.swap(loaded.slots);
+	handles.swap(loaded.handles);
+	freeHandles.swap(loaded.freeHandles);
+
+	Positions.swap(loaded.Positions);
+	PreviousPositions.swap(loaded.PreviousPositions);
+	Velocities.swap(loaded.Velocities);
+	Accelerations.swap(loaded.Accelerations);
+	AccumulatedForces.swap(loaded.AccumulatedForces);
+	Masses.swap(loaded.Masses);
+	InverseMasses.swap(loaded.InverseMasses);
+	Dampings.swap(loaded.Dampings);
+	Radii.swap(loaded.Radii);
+	Destroyed.swap(loaded.Destroyed);
+	Asleep.swap(loaded.Asleep);
+	SleepTimers.swap(loaded.SleepTimers);
+	SleepIslands.swap(loaded.SleepIslands);
+
+	for (unsigned int i = 0; i < Owners.size(); i++)
+	{
+		Owners[i]->store = this;
+		Owners[i]->handle = handles[i];
+	}
+
+	awakeDirty = true;
+	layoutVersion++;
+}
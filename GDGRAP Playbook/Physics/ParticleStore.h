@@ -0,0 +1,105 @@
+#pragma once
+#include <vector>
+
+#include "MyVector.h"
+#include "Snapshot.h"
+
+class PhysicsParticle;
+
+// Full state of a single particle, used while a particle is not yet owned by a store
+// and when copying state in or out of one.
+struct ParticleState
+{
+	MyVector Position;
+	MyVector Velocity;
+	MyVector Acceleration;
+	MyVector AccumulatedForce;
+	float Mass = 0;
+	float InverseMass = 0; // 0 for mass <= 0, i.e. immovable
+	float Damping = 1.0f;
+	float Radius = 0; // Collision sphere radius, 0 disables particle-particle collision
+	bool Destroyed = false;
+};
+
+// Structure-of-arrays storage for every particle of a PhysicsWorld.
+// The arrays are kept dense (removal swaps the last particle into the hole) so the
+// integration loop walks contiguous memory. Particles are referred to by stable
+// handles which stay valid until they are released.
+class ParticleStore
+{
+public:
+	typedef unsigned int Handle;
+
+	ParticleStore() = default;
+	ParticleStore(const ParticleStore&) = delete;
+	ParticleStore& operator=(const ParticleStore&) = delete;
+
+	std::vector<MyVector> Positions;
+	// Positions before the last world step, for blending rendered positions between steps
+	std::vector<MyVector> PreviousPositions;
+	std::vector<MyVector> Velocities;
+	std::vector<MyVector> Accelerations;
+	std::vector<MyVector> AccumulatedForces;
+	std::vector<float> Masses;
+	std::vector<float> InverseMasses;
+	std::vector<float> Dampings;
+	std::vector<float> Radii;
+	std::vector<unsigned char> Destroyed;
+
+	// Sleep state, maintained by IslandManager
+	std::vector<unsigned char> Asleep;
+	std::vector<float> SleepTimers; // Seconds the particle has been at rest
+	std::vector<unsigned int> SleepIslands; // Island the particle fell asleep with, or NoIsland
+
+	static constexpr unsigned int NoIsland = ~0u;
+
+	// The PhysicsParticle viewing each dense slot
+	std::vector<PhysicsParticle*> Owners;
+
+	Handle Allocate(PhysicsParticle* owner, const ParticleState& state);
+	void Release(Handle handle);
+	void SetOwner(Handle handle, PhysicsParticle* owner) { Owners[slots[handle]] = owner; }
+
+	ParticleState Read(Handle handle) const;
+	void Write(Handle handle, const ParticleState& state);
+	void SetRadius(unsigned int index, float radius);
+	void SetMass(unsigned int index, float mass, float inverseMass);
+
+	// Released handles map to an index past the end
+	unsigned int IndexOf(Handle handle) const { return slots[handle]; }
+	// One past the largest handle handed out so far
+	unsigned int HandleCount() const { return static_cast<unsigned int>(slots.size()); }
+	Handle HandleOf(unsigned int index) const { return handles[index]; }
+	unsigned int Size() const { return static_cast<unsigned int>(Positions.size()); }
+
+	// Falling asleep settles PreviousPositions; waking resets the particle's sleep timer
+	void SetAsleep(unsigned int index, bool asleep);
+	// Dense indices of the particles that are not asleep, ascending
+	const std::vector<unsigned int>& AwakeIndices() const;
+
+	// Saves every array and the handle tables. Load reads them into an empty store without
+	// touching any particle, failing unless every owner is known to the reader and the
+	// handle tables are consistent. Adopt then takes over a loaded store's particles under
+	// their saved handles: particles bound here but not in it are unbound first, and its
+	// particles that have been unbound since are bound again.
+	void Save(SnapshotWriter& out) const;
+	bool Load(SnapshotReader& in);
+	void Adopt(ParticleStore& loaded);
+
+	// Bumped whenever this store allocates, releases, changes a sleep flag or makes a particle
+	// movable or immovable, i.e. whenever dense indices may move or the set of simulated
+	// particles changes, and when a sleeping particle is written or resized, as SpatialHash
+	// caches the sleeping particles. Caches keyed on it also compare the store, as other
+	// stores count separately.
+	unsigned int LayoutVersion() const { return layoutVersion; }
+
+private:
+	std::vector<unsigned int> slots; // handle -> dense index
+	std::vector<Handle> handles; // dense index -> handle
+	std::vector<Handle> freeHandles;
+
+	mutable std::vector<unsigned int> awake;
+	mutable bool awakeDirty = true;
+
+	unsigned int layoutVersion = 0;
+};
@@ -2,17 +2,104 @@
 
 #include <cmath>
 
+PhysicsParticle::PhysicsParticle(const PhysicsParticle& other)
+	: staged(other.store ? other.store->Read(other.handle) : other.staged)
+{
+}
+
+PhysicsParticle::PhysicsParticle(PhysicsParticle&& other) noexcept
+	: store(other.store), handle(other.handle), staged(other.staged)
+{
+	if (store) store->SetOwner(handle, this);
+	other.store = nullptr;
+}
+
+PhysicsParticle& PhysicsParticle::operator=(const PhysicsParticle& other)
+{
+	if (this == &other) return *this;
+
+	ParticleState state = other.store ? other.store->Read(other.handle) : other.staged;
+	if (store) store->Write(handle, state);
+	else staged = state;
+	return *this;
+}
+
+PhysicsParticle& PhysicsParticle::operator=(PhysicsParticle&& other) noexcept
+{
+	if (this == &other) return *this;
+
+	if (store) store->Release(handle);
+
+	store = other.store;
+	handle = other.handle;
+	staged = other.staged;
+	if (store) store->SetOwner(handle, this);
+	other.store = nullptr;
+	return *this;
+}
+
+PhysicsParticle::~PhysicsParticle()
+{
+	if (store) store->Release(handle);
+}
+
+MyVector PhysicsParticle::InterpolatedPosition(float alpha) const
+{
+	if (!store) return staged.Position;
+
+	unsigned int i = store->IndexOf(handle);
+	const MyVector& previous = store->PreviousPositions[i];
+	return previous + (store->Positions[i] - previous) * alpha;
+}
+
+void PhysicsParticle::Bind(ParticleStore* newStore)
+{
+	if (newStore == store) return;
+
+	if (store)
+	{
+		staged = store->Read(handle);
+		store->Release(handle);
+	}
+
+	store = newStore;
+	if (store) handle = store->Allocate(this, staged);
+}
+
+void PhysicsParticle::SetMass(float mass)
+{
+	float inverseMass = mass > 0 ? 1.0f / mass : 0.0f;
+	if (store) store->SetMass(store->IndexOf(handle), mass, inverseMass);
+	else
+	{
+		staged.Mass = mass;
+		staged.InverseMass = inverseMass;
+	}
+}
+
+void PhysicsParticle::SetDamping(float damping)
+{
+	if (store) store->Dampings[store->IndexOf(handle)] = damping;
+	else staged.Damping = damping;
+}
+
+void PhysicsParticle::SetRadius(float radius)
+{
+	if (store) store->SetRadius(store->IndexOf(handle), radius);
+	else staged.Radius = radius;
+}
+
 void PhysicsParticle :: UpdatePosition(float time)
 {
 	// Update the position of the particle based on its velocity and time
-	this->Position = this->Position + (this->Velocity * time) + ((1.0f / 2.0f) * (this->Acceleration * time * time));
+	this->Position() = this->Position() + (this->Velocity() * time) + ((1.0f / 2.0f) * (this->Acceleration() * time * time));
 }
 
 void PhysicsParticle::UpdateVelocity(float time)
 {
-	this->Acceleration += accumulatedForce * (1.0f / mass);
-	this->Velocity += (this->Acceleration * time);
-	this->Velocity *= powf(damping, time); //Apply damping
+	this->Acceleration() += AccumulatedForce() * GetInverseMass();
+	this->Velocity() += (this->Acceleration() * time);
+	this->Velocity() *= powf(GetDamping(), time); //Apply damping
 }
 
 void PhysicsParticle::Update(float time)
@@ -25,16 +112,23 @@ void PhysicsParticle::Update(float time)
 
 void PhysicsParticle::Destroy()
 {
-	this->isDestroyed = true;
+	if (store) store->Destroyed[store->IndexOf(handle)] = 1;
+	else staged.Destroyed = true;
+}
+
+void PhysicsParticle::Wake()
+{
+	if (store) store->SetAsleep(store->IndexOf(handle), false);
 }
 
 void PhysicsParticle::AddForce(MyVector force)
 {
-	this->accumulatedForce += force;
+	Wake();
+	AccumulatedForce() += force;
 }
 
 void PhysicsParticle::ResetForce()
 {
-	this->accumulatedForce = MyVector(0, 0, 0);
-	this->Acceleration = MyVector(0, 0, 0);
-}
\ No newline at end of file
+	AccumulatedForce() = MyVector(0, 0, 0);
+	this->Acceleration() = MyVector(0, 0, 0);
+}
@@ -2,30 +2,70 @@
 #include <ctime>
 
 #include "MyVector.h"
+#include "ParticleStore.h"
 
+// View onto a particle. Until the particle is added to a PhysicsWorld its state lives
+// in the particle itself; once bound, the state lives in the world's ParticleStore and
+// this object only holds the handle.
 class PhysicsParticle
 {
 public:
-	float mass = 0;
-	MyVector Position;
-	MyVector Velocity;
-	MyVector Acceleration;
+	PhysicsParticle() = default;
+	PhysicsParticle(const PhysicsParticle& other);
+	PhysicsParticle(PhysicsParticle&& other) noexcept;
+	PhysicsParticle& operator=(const PhysicsParticle& other);
+	PhysicsParticle& operator=(PhysicsParticle&& other) noexcept;
+	~PhysicsParticle();
 
-	float damping = 1.0f; //Approximate drag 0.9f
+	MyVector& Position() { return store ? store->Positions[store->IndexOf(handle)] : staged.Position; }
+	const MyVector& Position() const { return store ? store->Positions[store->IndexOf(handle)] : staged.Position; }
 
-	//PhysicsParticle(float x, float y, float z) : Position(x, y, z), Velocity(0, 0, 0), Acceleration(0, 0, 0) {}
+	// Position blended between the previous and the current world step; alpha comes from
+	// PhysicsWorld::InterpolationAlpha
+	MyVector InterpolatedPosition(float alpha) const;
+
+	MyVector& Velocity() { return store ? store->Velocities[store->IndexOf(handle)] : staged.Velocity; }
+	const MyVector& Velocity() const { return store ? store->Velocities[store->IndexOf(handle)] : staged.Velocity; }
+
+	MyVector& Acceleration() { return store ? store->Accelerations[store->IndexOf(handle)] : staged.Acceleration; }
+	const MyVector& Acceleration() const { return store ? store->Accelerations[store->IndexOf(handle)] : staged.Acceleration; }
+
+	float GetMass() const { return store ? store->Masses[store->IndexOf(handle)] : staged.Mass; }
+	float GetInverseMass() const { return store ? store->InverseMasses[store->IndexOf(handle)] : staged.InverseMass; }
+	void SetMass(float mass);
+
+	float GetDamping() const { return store ? store->Dampings[store->IndexOf(handle)] : staged.Damping; }
+	void SetDamping(float damping);
+
+	float GetRadius() const { return store ? store->Radii[store->IndexOf(handle)] : staged.Radius; }
+	void SetRadius(float radius);
+
+	// Moves the particle's state into store (or back into the particle when store is null)
+	void Bind(ParticleStore* store);
+	ParticleStore* GetStore() const { return store; }
+	ParticleStore::Handle GetHandle() const { return handle; }
 
 protected:
+	friend class ParticleStore; // Rebinds particles when a snapshot is loaded
+
 	void UpdatePosition(float time);
 	void UpdateVelocity(float time);
 
-	bool isDestroyed = false;
-	MyVector accumulatedForce = MyVector(0, 0, 0);
+	ParticleStore* store = nullptr;
+	ParticleStore::Handle handle = 0;
+	ParticleState staged;
+
+	MyVector& AccumulatedForce() { return store ? store->AccumulatedForces[store->IndexOf(handle)] : staged.AccumulatedForce; }
 
 public:
 	void Update(float time);
 	void Destroy();
-	bool IsDestroyed() const { return isDestroyed; }
+	bool IsDestroyed() const { return store ? store->Destroyed[store->IndexOf(handle)] != 0 : staged.Destroyed; }
+
+	// Sleeping particles are not simulated until their island is woken. Adding a force wakes
+	// the particle; call Wake after moving one or changing its velocity by hand.
+	bool IsAsleep() const { return store && store->Asleep[store->IndexOf(handle)] != 0; }
+	void Wake();
 
 	void AddForce(MyVector force);
 	void ResetForce();
@@ -1,54 +1,315 @@
 #include "PhysicsWorld.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+PhysicsWorld::~PhysicsWorld()
+{
+	// Hand the state back to the particles so they outlive the world safely
+	while (Particles.Size() > 0) Particles.Owners.back()->Bind(nullptr);
+}
+
 void PhysicsWorld::AddParticle(PhysicsParticle* toAdd)
 {
-	this->Particles.push_back(toAdd);
+	toAdd->Bind(&Particles);
 	forceRegistry.Add(toAdd, &Gravity);
 }
 
+void PhysicsWorld::AddLink(ParticleLink* link)
+{
+	Links.push_back(link);
+	Islands.LinksChanged();
+}
+
+void PhysicsWorld::RemoveLink(ParticleLink* link)
+{
+	Links.remove(link);
+	Islands.LinksChanged();
+}
+
+void PhysicsWorld::SetGravity(const MyVector& gravity)
+{
+	Gravity = GravityForceGenerator(gravity);
+	Islands.WakeAll(Particles);
+}
+
 void PhysicsWorld::Update(float time)
 {
-	constexpr float maxStep = 0.01f; // 10 ms per sub-step
+	const float maxStep = MaxSubstep > 0.0f ? MaxSubstep : 0.01f;
+	if (PositionBased && time > 0.0f)
+	{
+		// Projection turns each step's correction into velocity by dividing by the step, so
+		// a sliver of a remainder step would blow the leftover error up into a huge velocity
+		const unsigned int steps = static_cast<unsigned int>(std::ceil(time / maxStep));
+		const float dt = time / static_cast<float>(steps);
+		for (unsigned int step = 0; step < steps; step++) Step(dt);
+		return;
+	}
+
 	while (time > 0.0f)
 	{
 		float dt = (time > maxStep) ? maxStep : time;
-		UpdateParticleList();
-		forceRegistry.UpdateForces(dt);
-		for (auto* p : Particles) p->Update(dt);
-		GenerateContacts();
-		if (!Contacts.empty()) contactResolver.ResolveContacts(Contacts, dt);
+		Step(dt);
 		time -= dt;
 	}
 }
 
-void PhysicsWorld::AddContact(PhysicsParticle* p1, PhysicsParticle* p2, float restitution, MyVector contactNormal)
+int PhysicsWorld::Advance(float frameTime)
+{
+	const float step = StepLength();
+	accumulator += frameTime;
+
+	int steps = 0;
+	while (accumulator >= step && steps < MaxStepsPerFrame)
+	{
+		Step(step);
+		accumulator -= step;
+		steps++;
+	}
+
+	// Out of steps for this frame: drop the whole steps still owed, keep the fraction
+	if (accumulator >= step) accumulator = std::fmod(accumulator, step);
+	return steps;
+}
+
+void PhysicsWorld::Step(float dt)
+{
+	UpdateParticleList();
+
+	// Sleeping particles do not move, so their previous positions are already current
+	for (unsigned int i : Particles.AwakeIndices()) Particles.PreviousPositions[i] = Particles.Positions[i];
+
+	forceRegistry.SetImplicitSprings(ImplicitSprings);
+	forceRegistry.UpdateForces(dt, &Workers);
+	if (ImplicitSprings) SpringSolver.Apply(Particles, forceRegistry.GetSprings(), SpringSets, dt, &Workers);
+	else
+	{
+		for (SpringSet* springs : SpringSets) springs->UpdateForces(Particles, &Workers);
+	}
+	Integrator.Integrate(Particles, dt, &Workers);
+	if (ImplicitSprings) SpringSolver.CorrectPositions(Particles, dt);
+	if (PositionBased) ProjectLinks(dt);
+	GenerateContacts();
+	if (!Contacts.Empty()) Resolver.ResolveContacts(Contacts.Data(), Contacts.Size(), dt, &Workers);
+	Islands.Update(Particles, Links, SpringSets, forceRegistry, Contacts, dt);
+}
+
+namespace
+{
+	const char SnapshotMagic[4] = { 'G', 'D', 'W', 'S' };
+	const unsigned int SnapshotVersion = 3;
+}
+
+void PhysicsWorld::SaveSnapshot(std::vector<unsigned char>& snapshot) const
 {
-	auto toAdd = new ParticleContact();
+	snapshot.clear();
+	SnapshotWriter out(snapshot);
+	out.Write(SnapshotMagic);
+	out.Write(SnapshotVersion);
+
+	out.Write(accumulator);
+	out.Write(Gravity.GetGravity());
+	Particles.Save(out);
+	Islands.Save(out);
+
+	out.Write(static_cast<unsigned int>(Links.size()));
+	for (const ParticleLink* link : Links)
+	{
+		out.WritePointer(link);
+		link->Save(out);
+	}
+
+	out.Write(static_cast<unsigned int>(SpringSets.size()));
+	for (const SpringSet* springs : SpringSets) out.WritePointer(springs);
+
+	forceRegistry.Save(out);
+	Resolver.Save(out);
+}
+
+bool PhysicsWorld::RestoreSnapshot(const std::vector<unsigned char>& snapshot, std::string& error)
+{
+	SnapshotReader in(snapshot.data(), snapshot.size());
+
+	char magic[4];
+	unsigned int version = 0;
+	in.Read(magic);
+	in.Read(version);
+	if (in.Failed() || std::memcmp(magic, SnapshotMagic, sizeof(magic)) != 0 || version != SnapshotVersion)
+	{
+		error = "Not a world snapshot of this version";
+		return false;
+	}
+
+	// Everything the snapshot names must still be in the world: its particles, or particles
+	// that have left it but still have force registrations or are held by one of its links,
+	// its links and its spring sets. Any other address fails the reader before it is dereferenced.
+	// Particles now bound to another store are never taken over.
+	std::unordered_set<const void*> referenced;
+	forceRegistry.CollectParticles(referenced);
+	std::unordered_map<uintptr_t, ParticleLink*> liveLinks;
+	for (ParticleLink* link : Links)
+	{
+		liveLinks[reinterpret_cast<uintptr_t>(link)] = link;
+		referenced.insert(link->particles[0]);
+		referenced.insert(link->particles[1]);
+	}
+	std::unordered_set<const void*> knownParticles(Particles.Owners.begin(), Particles.Owners.end());
+	for (const void* address : referenced)
+	{
+		const PhysicsParticle* particle = static_cast<const PhysicsParticle*>(address);
+		if (particle && !particle->GetStore()) knownParticles.insert(particle);
+	}
+	std::unordered_map<uintptr_t, SpringSet*> liveSpringSets;
+	for (SpringSet* springs : SpringSets) liveSpringSets[reinterpret_cast<uintptr_t>(springs)] = springs;
+	in.SetKnownPointers(&knownParticles);
+
+	// Read everything aside first and only take it over once the whole snapshot checks out
+	float loadedAccumulator = 0.0f;
+	MyVector gravity;
+	in.Read(loadedAccumulator);
+	in.Read(gravity);
+	ParticleStore loadedParticles;
+	IslandManager loadedIslands;
+	bool valid = loadedParticles.Load(in) && loadedIslands.Load(in, loadedParticles);
+
+	// Links load into themselves, so each one's state is kept to put back on failure
+	unsigned int linkCount = 0;
+	in.Read(linkCount);
+	std::list<ParticleLink*> loadedLinks;
+	std::vector<unsigned char> linkBackup;
+	SnapshotWriter backup(linkBackup);
+	for (unsigned int i = 0; valid && i < linkCount && !in.Failed(); i++)
+	{
+		uintptr_t address = 0;
+		in.Read(address);
+		auto live = liveLinks.find(address);
+		if (live == liveLinks.end()) valid = false;
+		else
+		{
+			ParticleLink* link = live->second;
+			liveLinks.erase(live);
+			link->Save(backup);
+			loadedLinks.push_back(link);
+			link->Load(in);
+		}
+	}
+
+	unsigned int springSetCount = 0;
+	in.Read(springSetCount);
+	std::list<SpringSet*> loadedSpringSets;
+	for (unsigned int i = 0; valid && i < springSetCount && !in.Failed(); i++)
+	{
+		uintptr_t address = 0;
+		in.Read(address);
+		auto live = liveSpringSets.find(address);
+		if (live == liveSpringSets.end()) valid = false;
+		else
+		{
+			loadedSpringSets.push_back(live->second);
+			liveSpringSets.erase(live);
+		}
+	}
+
+	ForceRegistry loadedRegistry;
+	ContactResolver loadedResolver(0);
+	valid = valid && loadedRegistry.Load(in, forceRegistry) && loadedResolver.Load(in);
+
+	if (!valid || in.Failed() || !in.AtEnd())
+	{
+		SnapshotReader restore(linkBackup.data(), linkBackup.size());
+		for (ParticleLink* link : loadedLinks) link->Load(restore);
+		error = "World snapshot is damaged or refers to particles, links or spring sets no longer in the world";
+		return false;
+	}
+
+	accumulator = loadedAccumulator;
+	Gravity = GravityForceGenerator(gravity);
+	Particles.Adopt(loadedParticles);
+	Islands.Adopt(loadedIslands);
+	Islands.LinksChanged();
+	Links.swap(loadedLinks);
+	SpringSets.swap(loadedSpringSets);
+	forceRegistry.Adopt(loadedRegistry);
+	Resolver.Adopt(loadedResolver);
+	return true;
+}
+
+void PhysicsWorld::AddContact(PhysicsParticle* p1, PhysicsParticle* p2, float restitution, MyVector contactNormal, float depth)
+{
+	ParticleContact* toAdd = Contacts.Allocate();
 	toAdd->particles[0] = p1;
 	toAdd->particles[1] = p2;
 
 	toAdd->restitution = restitution;
 	toAdd->contactNormal = contactNormal;
-
-	Contacts.push_back(toAdd);
+	toAdd->depth = depth;
 }
 
 void PhysicsWorld::UpdateParticleList()
 {
-	Particles.remove_if([](PhysicsParticle* p) { return p->IsDestroyed(); });
+	// Most steps destroy nothing, so skip straight to the first destroyed particle
+	auto first = std::find(Particles.Destroyed.begin(), Particles.Destroyed.end(), 1);
+	for (unsigned int i = static_cast<unsigned int>(first - Particles.Destroyed.begin()); i < Particles.Size();)
+	{
+		// Unbinding swaps the last particle into slot i, so only advance when nothing was removed.
+		// Whatever the particle was holding up has to be simulated again.
+		if (Particles.Destroyed[i])
+		{
+			Islands.WakeIsland(Particles, i);
+			Particles.Owners[i]->Bind(nullptr);
+		}
+		else i++;
+	}
+}
+
+void PhysicsWorld::ProjectLinks(float dt)
+{
+	projectedLinks.clear();
+	for (ParticleLink* link : Links)
+	{
+		if (link->IsAsleep() || !link->CanProject()) continue;
+		link->StartProjection();
+		projectedLinks.push_back(link);
+	}
+	if (projectedLinks.empty()) return;
+
+	predictedPositions.assign(Particles.Positions.begin(), Particles.Positions.end());
+	for (unsigned int iteration = 0; iteration < PositionIterations; iteration++)
+	{
+		for (ParticleLink* link : projectedLinks) link->Project(dt);
+	}
+
+	// Particles no link moved gain exactly zero
+	const float inverseDt = 1.0f / dt;
+	for (unsigned int i = 0; i < Particles.Size(); i++)
+	{
+		Particles.Velocities[i] += (Particles.Positions[i] - predictedPositions[i]) * inverseDt;
+	}
 }
 
 void PhysicsWorld::GenerateContacts()
 {
-	Contacts.clear();
+	Contacts.Reset();
+
+	// The broadphase only reads particles, so it runs alongside the links
+	JobCounter broadphaseDone;
+	Workers.Submit([this] { broadphase.FindOverlaps(Particles, overlaps, &Workers); }, broadphaseDone);
+
 	for (auto i = Links.begin();
 	     i != Links.end(); ++i)
 	{
-		ParticleContact* contact = (*i)->GetContact();
+		if ((*i)->IsAsleep() || (PositionBased && (*i)->CanProject())) continue;
+		(*i)->GetContact(Contacts);
+	}
 
-		if (contact != nullptr)
-		{
-			Contacts.push_back(contact);
-		}
+	Workers.Wait(broadphaseDone);
+	for (const SpatialHash::Overlap& overlap : overlaps)
+	{
+		AddContact(Particles.Owners[overlap.a], Particles.Owners[overlap.b], CollisionRestitution, overlap.normal,
+		           overlap.depth);
 	}
 }
@@ -1,32 +1,121 @@
 #pragma once
 #include <list>
+#include <string>
+#include <vector>
 #include "PhysicsParticle.h"
-#include "../ParticleLink.h"
+#include "ParticleStore.h"
+#include "ParticleIntegrator.h"
+#include "SpatialHash.h"
+#include "ParticleLink.h"
 
 #include "ForceRegistry.h"
 #include "GravityForceGenerator.h"
 #include "ContactResolver.h"
+#include "ContactArena.h"
+#include "WorkerPool.h"
+#include "IslandManager.h"
+#include "ImplicitSpringSolver.h"
+#include "SpringSet.h"
 
 class PhysicsWorld
 {
 public:
+	PhysicsWorld() = default;
+	~PhysicsWorld();
+
 	ForceRegistry forceRegistry;
 
-	std::list<PhysicsParticle*> Particles;
+	// Job system the stages fork their work onto; with no threads (the default) every
+	// stage runs on the calling thread
+	WorkerPool Workers;
+
+	// Contiguous state of every particle added to the world
+	ParticleStore Particles;
+	ParticleIntegrator Integrator;
 	std::list<ParticleLink*> Links;
+	// Springs evaluated in bulk after the force registry, each spring once for both particles
+	std::list<SpringSet*> SpringSets;
 
 	void AddParticle(PhysicsParticle* toAdd);
+	// Edit Links through these so the sleeping islands see the change; a link added or
+	// removed on Links directly is only noticed through the list's length
+	void AddLink(ParticleLink* link);
+	void RemoveLink(ParticleLink* link);
+	// Gravity applied to every particle added through AddParticle
+	void SetGravity(const MyVector& gravity);
+	// Simulates time in sub-steps of at most MaxSubstep, the last one taking the remainder.
+	// With PositionBased the sub-steps are all the same length instead.
 	void Update(float time);
+	float MaxSubstep = 0.01f;
+
+	// Position-based dynamics for links: each step, links that can project themselves
+	// (Rod, Chain, DistanceConstraint) move their particles straight onto the constraint,
+	// PositionIterations times after integration, and every particle's velocity then gains
+	// the distance it was moved divided by the step. Those links produce no contacts;
+	// collisions still go through the contact resolver. This stays stable at steps far
+	// longer than contact-based links tolerate, so MaxSubstep and FixedStep can be raised.
+	bool PositionBased = false;
+	unsigned int PositionIterations = 10;
+
+	// Solves spring generators (ParticleSpring, AnchoredSpring, Bungee) and SpringSets with backward Euler
+	// instead of applying them as explicit forces, so stiff springs stay stable at 30-60 Hz
+	// steps; see ImplicitSpringSolver
+	bool ImplicitSprings = false;
+	ImplicitSpringSolver SpringSolver;
+
+	// Fixed-rate stepping for frame loops: Advance adds the frame's time to an accumulator
+	// and runs as many FixedStep steps as it covers, at most MaxStepsPerFrame. Time left
+	// over after that many steps is dropped, so a slow frame makes the simulation fall
+	// behind instead of taking ever longer. Returns the number of steps run. A FixedStep of
+	// 0 or less is treated as 1/120 s, as Update treats such a MaxSubstep as 0.01 s.
+	float FixedStep = 1.0f / 120.0f;
+	int MaxStepsPerFrame = 8;
+	int Advance(float frameTime);
+	// How far the accumulator is into the next step, in [0, 1). Render at
+	// PhysicsParticle::InterpolatedPosition(alpha) to blend the last two steps.
+	float InterpolationAlpha() const { return accumulator / StepLength(); }
 
-	std::list<ParticleContact*> Contacts;
+	// Writes the state of every particle, link, spring set, force registration and sleeping island, and
+	// the contact resolver's warm start impulses, into snapshot, replacing its contents;
+	// reusing the vector makes this cheap enough for every frame. Stepping after RestoreSnapshot repeats the original run bit for bit.
+	// Particles, links, spring sets and generators are recorded by address, and restoring
+	// looks each one up among the live ones: the links, spring sets and generators must still
+	// be in the world, and each particle too, or else registered with its force registry or
+	// held by one of its links.
+	// Generator and spring set parameters other than the world gravity are not recorded.
+	void SaveSnapshot(std::vector<unsigned char>& snapshot) const;
+	// Fails, leaving the world untouched, for a damaged snapshot or one that refers to
+	// objects no longer in the world
+	bool RestoreSnapshot(const std::vector<unsigned char>& snapshot, std::string& error);
 
-	void AddContact(PhysicsParticle* p1, PhysicsParticle* p2, float restitution, MyVector contactNormal);
+	// Contacts of the current substep, rebuilt by GenerateContacts
+	ContactArena Contacts;
+
+	// Resolver.mode picks the contact solver; ContactResolver::Colored uses the workers
+	ContactResolver Resolver = ContactResolver(100); // Max iterations
+
+	// Puts particles at rest to sleep; see IslandManager for the thresholds
+	IslandManager Islands;
+
+	// Bounciness of contacts between overlapping particle spheres
+	float CollisionRestitution = 0.9f;
+
+	void AddContact(PhysicsParticle* p1, PhysicsParticle* p2, float restitution, MyVector contactNormal, float depth = 0);
 
 private:
+	void Step(float dt);
 	void UpdateParticleList();
+	void ProjectLinks(float dt);
+	// FixedStep, or its default when it is not positive
+	float StepLength() const { return FixedStep > 0.0f ? FixedStep : 1.0f / 120.0f; }
+	float accumulator = 0.0f;
 	GravityForceGenerator Gravity = GravityForceGenerator(MyVector(0, -9.8f, 0)); //0, -9.8f, 0
 
-	ContactResolver contactResolver = ContactResolver(100); // Max iterations, tolerance
+	SpatialHash broadphase;
+	std::vector<SpatialHash::Overlap> overlaps;
+
+	std::vector<ParticleLink*> projectedLinks;
+	std::vector<MyVector> predictedPositions;
 
 protected:
 	void GenerateContacts();
@@ -0,0 +1,53 @@
+#include "Rod.h"
+
+	ParticleContact* Rod::GetContact(ContactArena& contacts) {
+		MyVector dir;
+		float currLen = (particles[1]->Position() - particles[0]->Position()).MagnitudeAndDirection(dir);
+
+		if (currLen == length) {
+			return nullptr;
+		}
+
+		ParticleContact* ret = contacts.Allocate();
+		ret->particles[0] = particles[0];
+		ret->particles[1] = particles[1];
+
+		if (currLen > length)
+		{
+			ret->contactNormal = dir;
+			ret->depth = currLen - length;
+
+		}
+		else
+		{
+			ret->contactNormal = dir * -1;
+			ret->depth = length - currLen;
+		}
+
+		ret->restitution = restitution;
+
+		return ret;
+	}
+
+	void Rod::Project(float time)
+	{
+		MyVector axis = particles[0]->Position() - particles[1]->Position();
+		float distance = axis.Magnitude();
+		if (distance <= 0.0f) return;
+
+		MoveApart(axis * (1.0f / distance), length - distance);
+	}
+
+	void Rod::Save(SnapshotWriter& out) const
+	{
+		ParticleLink::Save(out);
+		out.Write(length);
+		out.Write(restitution);
+	}
+
+	void Rod::Load(SnapshotReader& in)
+	{
+		ParticleLink::Load(in);
+		in.Read(length);
+		in.Read(restitution);
+	}
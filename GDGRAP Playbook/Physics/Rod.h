@@ -0,0 +1,16 @@
+#pragma once
+#include "ParticleLink.h"
+
+
+	class Rod : public ParticleLink {
+	public:
+		float length = 1;
+		float restitution = 0;
+
+		ParticleContact* GetContact(ContactArena& contacts) override;
+		// Position-based: holds the particles exactly length apart; restitution does not apply
+		bool CanProject() const override { return true; }
+		void Project(float time) override;
+		void Save(SnapshotWriter& out) const override;
+		void Load(SnapshotReader& in) override;
+	};
@@ -0,0 +1,25 @@
+#pragma once
+
+// Shared by the physics files with SIMD kernels. PHYSICS_SIMD is 1 on x86, where the SSE and
+// AVX2 kernels are compiled and picked at run time (ParticleIntegrator::BestAvailable).
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PHYSICS_SIMD 1
+#include <immintrin.h>
+#else
+#define PHYSICS_SIMD 0
+#endif
+
+// GCC and Clang need the instruction set enabled per function; MSVC accepts the intrinsics as is
+#if defined(__GNUC__)
+#define PHYSICS_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PHYSICS_TARGET(isa)
+#endif
+
+// 1 when the compiler may use SSE anywhere, not just in PHYSICS_TARGET functions: always
+// on x86-64, and on 32-bit x86 when SSE code generation is enabled
+#if PHYSICS_SIMD && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define PHYSICS_SSE 1
+#else
+#define PHYSICS_SSE 0
+#endif
@@ -0,0 +1,117 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+// Binary streams used by PhysicsWorld::SaveSnapshot and RestoreSnapshot.
+// Values are stored as raw bytes and objects by address, so a snapshot is only meaningful
+// inside the process that took it. Readers look every address up among live objects
+// before using it, so a snapshot naming an object freed since fails to load instead.
+
+class SnapshotWriter
+{
+public:
+	explicit SnapshotWriter(std::vector<unsigned char>& buffer) : buffer(buffer) {}
+
+	template <typename T>
+	void Write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Snapshots hold raw bytes");
+		Append(&value, sizeof(T));
+	}
+
+	template <typename T>
+	void WriteArray(const std::vector<T>& values)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Snapshots hold raw bytes");
+		Write(static_cast<unsigned int>(values.size()));
+		Append(values.data(), values.size() * sizeof(T));
+	}
+
+	void WritePointer(const void* pointer) { Write(reinterpret_cast<uintptr_t>(pointer)); }
+
+private:
+	void Append(const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		buffer.insert(buffer.end(), bytes, bytes + size);
+	}
+
+	std::vector<unsigned char>& buffer;
+};
+
+// Reads back what a SnapshotWriter wrote, in the same order. Reading past the end fails
+// the reader instead of overrunning; values read after that are zero.
+class SnapshotReader
+{
+public:
+	SnapshotReader(const unsigned char* data, size_t size) : data(data), size(size) {}
+
+	template <typename T>
+	void Read(T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Snapshots hold raw bytes");
+		Take(&value, sizeof(T));
+	}
+
+	template <typename T>
+	void ReadArray(std::vector<T>& values)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Snapshots hold raw bytes");
+		unsigned int count = 0;
+		Read(count);
+		if (count > (size - position) / (sizeof(T) ? sizeof(T) : 1))
+		{
+			failed = true;
+			count = 0;
+		}
+		values.resize(count);
+		Take(values.data(), count * sizeof(T));
+	}
+
+	// Reads an address written by WritePointer. With known pointers set, any address other
+	// than nullptr and those fails the reader and reads as nullptr.
+	template <typename T>
+	void ReadPointer(T*& pointer)
+	{
+		uintptr_t address = 0;
+		Read(address);
+		pointer = reinterpret_cast<T*>(address);
+		if (!IsKnown(pointer))
+		{
+			failed = true;
+			pointer = nullptr;
+		}
+	}
+
+	// The live objects ReadPointer may return; nullptr lifts the restriction
+	void SetKnownPointers(const std::unordered_set<const void*>* addresses) { known = addresses; }
+	bool IsKnown(const void* pointer) const { return !pointer || !known || known->count(pointer) > 0; }
+
+	// For checks the reader cannot make itself
+	void Fail() { failed = true; }
+	bool Failed() const { return failed; }
+	bool AtEnd() const { return position == size; }
+
+private:
+	void Take(void* out, size_t count)
+	{
+		if (count == 0) return;
+		if (failed || count > size - position)
+		{
+			failed = true;
+			std::memset(out, 0, count);
+			return;
+		}
+		std::memcpy(out, data + position, count);
+		position += count;
+	}
+
+	const unsigned char* data;
+	size_t size;
+	size_t position = 0;
+	bool failed = false;
+	const std::unordered_set<const void*>* known = nullptr;
+};
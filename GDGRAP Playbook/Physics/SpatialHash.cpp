@@ -0,0 +1,174 @@
+#include "SpatialHash.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "WorkerPool.h"
+
+namespace
+{
+	// Colliders queried per job; fixed so the overlaps come out in the same order on any
+	// number of threads
+	const unsigned int QueryChunk = 1024;
+}
+
+void SpatialHash::Grid::Build(const ParticleStore& store, float inverseCellSize)
+{
+	const unsigned int count = static_cast<unsigned int>(colliders.size());
+
+	// Power of two table with about twice as many buckets as colliders
+	unsigned int bucketCount = 1;
+	while (bucketCount < 2 * count) bucketCount <<= 1;
+	mask = bucketCount - 1;
+
+	cells.resize(3 * count);
+	bucketStart.assign(bucketCount + 1, 0);
+	bucketEntries.resize(count);
+
+	for (unsigned int c = 0; c < count; c++)
+	{
+		const MyVector& pos = store.Positions[colliders[c]];
+		cells[3 * c] = static_cast<int>(std::floor(pos.x * inverseCellSize));
+		cells[3 * c + 1] = static_cast<int>(std::floor(pos.y * inverseCellSize));
+		cells[3 * c + 2] = static_cast<int>(std::floor(pos.z * inverseCellSize));
+
+		bucketStart[Hash(cells[3 * c], cells[3 * c + 1], cells[3 * c + 2], mask) + 1]++;
+	}
+
+	for (unsigned int b = 0; b < bucketCount; b++)
+		bucketStart[b + 1] += bucketStart[b];
+
+	// Counting sort: scatter each collider into its bucket, then restore the starts
+	for (unsigned int c = 0; c < count; c++)
+	{
+		unsigned int bucket = Hash(cells[3 * c], cells[3 * c + 1], cells[3 * c + 2], mask);
+		bucketEntries[bucketStart[bucket]++] = colliders[c];
+	}
+	for (unsigned int b = bucketCount; b > 0; b--)
+		bucketStart[b] = bucketStart[b - 1];
+	bucketStart[0] = 0;
+}
+
+void SpatialHash::FindOverlaps(const ParticleStore& store, std::vector<Overlap>& overlaps, WorkerPool* workers)
+{
+	overlaps.clear();
+
+	if (sleepingStore != &store || sleepingLayout != store.LayoutVersion())
+	{
+		sleeping.colliders.clear();
+		sleepingMaxRadius = 0;
+		for (unsigned int i = 0; i < store.Size(); i++)
+		{
+			if (!store.Asleep[i] || store.Radii[i] <= 0 || store.Destroyed[i]) continue;
+
+			sleeping.colliders.push_back(i);
+			if (store.Radii[i] > sleepingMaxRadius) sleepingMaxRadius = store.Radii[i];
+		}
+		sleepingCellRadius = 0;
+		sleepingStore = &store;
+		sleepingLayout = store.LayoutVersion();
+	}
+
+	awake.colliders.clear();
+	float maxRadius = sleepingMaxRadius;
+	for (unsigned int i : store.AwakeIndices())
+	{
+		if (store.Radii[i] <= 0 || store.Destroyed[i]) continue;
+
+		awake.colliders.push_back(i);
+		if (store.Radii[i] > maxRadius) maxRadius = store.Radii[i];
+	}
+
+	const unsigned int count = static_cast<unsigned int>(awake.colliders.size());
+	if (count == 0 || count + sleeping.colliders.size() < 2) return;
+
+	// Both grids must share a cell size; the sleeping one is only rebuilt when it changes
+	const float inverseCellSize = 1.0f / (2.0f * maxRadius);
+	if (!sleeping.colliders.empty() && sleepingCellRadius != maxRadius)
+	{
+		sleeping.Build(store, inverseCellSize);
+		sleepingCellRadius = maxRadius;
+	}
+	awake.Build(store, inverseCellSize);
+
+	auto queryRange = [this, &store](unsigned int begin, unsigned int end, std::vector<Overlap>& out)
+	{
+		for (unsigned int c = begin; c < end; c++)
+		{
+			Query(store, awake, c, awake, true, out);
+			if (!sleeping.colliders.empty()) Query(store, awake, c, sleeping, false, out);
+		}
+	};
+
+	if (!workers || workers->GetThreadCount() == 0 || count <= QueryChunk)
+	{
+		queryRange(0, count, overlaps);
+		return;
+	}
+
+	const unsigned int chunks = (count + QueryChunk - 1) / QueryChunk;
+	if (chunkOverlaps.size() < chunks) chunkOverlaps.resize(chunks);
+	workers->ParallelFor(chunks, 1, [this, count, &queryRange](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int chunk = begin; chunk < end; chunk++)
+		{
+			chunkOverlaps[chunk].clear();
+			queryRange(chunk * QueryChunk, std::min((chunk + 1) * QueryChunk, count), chunkOverlaps[chunk]);
+		}
+	});
+
+	for (unsigned int chunk = 0; chunk < chunks; chunk++)
+	{
+		overlaps.insert(overlaps.end(), chunkOverlaps[chunk].begin(), chunkOverlaps[chunk].end());
+	}
+}
+
+void SpatialHash::Query(const ParticleStore& store, const Grid& from, unsigned int c, const Grid& to, bool sameGrid,
+                        std::vector<Overlap>& overlaps)
+{
+	const unsigned int i = from.colliders[c];
+	const MyVector& posA = store.Positions[i];
+	const float radiusA = store.Radii[i];
+	const int* cell = &from.cells[3 * c];
+
+	// Different cells may share a bucket; visit each bucket once so no pair is reported twice
+	unsigned int visited[27];
+	unsigned int visitedCount = 0;
+
+	for (int x = -1; x <= 1; x++)
+	for (int y = -1; y <= 1; y++)
+	for (int z = -1; z <= 1; z++)
+	{
+		unsigned int bucket = Hash(cell[0] + x, cell[1] + y, cell[2] + z, to.mask);
+
+		bool seen = false;
+		for (unsigned int v = 0; v < visitedCount && !seen; v++) seen = visited[v] == bucket;
+		if (seen) continue;
+		visited[visitedCount++] = bucket;
+
+		for (unsigned int e = to.bucketStart[bucket]; e < to.bucketStart[bucket + 1]; e++)
+		{
+			const unsigned int j = to.bucketEntries[e];
+			if (sameGrid && j <= i) continue;
+
+			// Written out by hand to keep the innermost test free of calls
+			const MyVector& posB = store.Positions[j];
+			float dx = posA.x - posB.x;
+			float dy = posA.y - posB.y;
+			float dz = posA.z - posB.z;
+			float reach = radiusA + store.Radii[j];
+			float distanceSquared = dx * dx + dy * dy + dz * dz;
+			if (distanceSquared >= reach * reach) continue;
+
+			float distance = std::sqrt(distanceSquared);
+
+			Overlap overlap;
+			overlap.a = i;
+			overlap.b = j;
+			// Coincident centres have no direction; push them apart vertically
+			overlap.normal = distance > 0 ? MyVector(dx, dy, dz) * (1.0f / distance) : MyVector(0, 1, 0);
+			overlap.depth = reach - distance;
+			overlaps.push_back(overlap);
+		}
+	}
+}
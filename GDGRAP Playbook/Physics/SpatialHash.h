@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+
+#include "MyVector.h"
+#include "ParticleStore.h"
+
+class WorkerPool;
+
+// Broadphase for particle-particle collision.
+// Every particle with a radius is hashed into a uniform grid whose cells are as wide as the
+// largest sphere, so overlapping spheres always lie in the same or an adjacent cell. The grid
+// is rebuilt each call with a counting sort, keeping the whole pass close to linear in the
+// number of particles. Sleeping particles go into a second grid that is only rebuilt when the
+// store's layout changes, and pairs of two sleeping particles are never tested.
+class SpatialHash
+{
+public:
+	struct Overlap
+	{
+		unsigned int a, b; // Dense indices into the store
+		MyVector normal; // Points from b to a
+		float depth;
+	};
+
+	// Replaces the contents of overlaps with every pair of intersecting spheres of which at
+	// least one is awake. Queries are split over workers when given; the overlaps come out
+	// in the same order either way.
+	void FindOverlaps(const ParticleStore& store, std::vector<Overlap>& overlaps, WorkerPool* workers = nullptr);
+
+private:
+	static unsigned int Hash(int x, int y, int z, unsigned int mask)
+	{
+		return ((static_cast<unsigned int>(x) * 73856093u) ^
+			(static_cast<unsigned int>(y) * 19349663u) ^
+			(static_cast<unsigned int>(z) * 83492791u)) & mask;
+	}
+
+	struct Grid
+	{
+		std::vector<unsigned int> colliders; // Dense indices of particles with a radius
+		std::vector<int> cells; // Cell coordinates of each collider, 3 per collider
+		std::vector<unsigned int> bucketStart; // Prefix sums of bucket sizes, one extra at the end
+		std::vector<unsigned int> bucketEntries; // Dense indices grouped by bucket
+		unsigned int mask = 0;
+
+		void Build(const ParticleStore& store, float inverseCellSize);
+	};
+
+	// Appends the overlaps of collider c of from with the colliders of to, skipping
+	// indices at or below its own when both are the same grid
+	static void Query(const ParticleStore& store, const Grid& from, unsigned int c, const Grid& to, bool sameGrid,
+	                  std::vector<Overlap>& overlaps);
+
+	Grid awake;
+	Grid sleeping;
+	float sleepingMaxRadius = 0;
+	float sleepingCellRadius = 0; // Radius the sleeping grid's cells were sized for
+	const ParticleStore* sleepingStore = nullptr; // The store and layout the sleeping grid was built from
+	unsigned int sleepingLayout = ~0u;
+
+	std::vector<std::vector<Overlap>> chunkOverlaps; // Per job when queries run on workers
+};
@@ -0,0 +1,313 @@
+#include "SpringSet.h"
+
+#include <cmath>
+
+#include "PhysicsParticle.h"
+#include "Simd.h"
+#include "WorkerPool.h"
+
+namespace
+{
+	// Springs or particles per job
+	const unsigned int Chunk = 1024;
+
+	// The kernels turn each spring's offset (first particle minus other end), held in x, y
+	// and z, into the force on its first particle
+	struct Arrays
+	{
+		float* x;
+		float* y;
+		float* z;
+		const float* stiffness;
+		const float* restLength;
+		const float* absolute;
+	};
+
+	void ForcesScalar(const Arrays& arr, unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			float x = arr.x[i], y = arr.y[i], z = arr.z[i];
+			float length = std::sqrt(x * x + y * y + z * z);
+
+			// |stretch| for absolute springs; for stretch only ones, stretch or nothing
+			float stretch = length - arr.restLength[i];
+			float compressed = -stretch * arr.absolute[i];
+			float amount = stretch > compressed ? stretch : compressed;
+
+			float scale = length > 0.0f ? -(arr.stiffness[i] * amount) / length : 0.0f;
+			arr.x[i] = x * scale;
+			arr.y[i] = y * scale;
+			arr.z[i] = z * scale;
+		}
+	}
+
+#if PHYSICS_SIMD
+	PHYSICS_TARGET("sse2")
+	void ForcesSSE(const Arrays& arr, unsigned int begin, unsigned int end)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 sign = _mm_set1_ps(-0.0f);
+
+		unsigned int i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(arr.x + i);
+			__m128 y = _mm_loadu_ps(arr.y + i);
+			__m128 z = _mm_loadu_ps(arr.z + i);
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+
+			// maxps returns its second operand unless the first is greater, like the scalar kernel
+			__m128 stretch = _mm_sub_ps(length, _mm_loadu_ps(arr.restLength + i));
+			__m128 compressed = _mm_mul_ps(_mm_xor_ps(stretch, sign), _mm_loadu_ps(arr.absolute + i));
+			__m128 amount = _mm_max_ps(stretch, compressed);
+
+			__m128 tension = _mm_xor_ps(_mm_mul_ps(_mm_loadu_ps(arr.stiffness + i), amount), sign);
+			__m128 scale = _mm_and_ps(_mm_div_ps(tension, length), _mm_cmpgt_ps(length, zero));
+			_mm_storeu_ps(arr.x + i, _mm_mul_ps(x, scale));
+			_mm_storeu_ps(arr.y + i, _mm_mul_ps(y, scale));
+			_mm_storeu_ps(arr.z + i, _mm_mul_ps(z, scale));
+		}
+
+		ForcesScalar(arr, i, end);
+	}
+
+	PHYSICS_TARGET("avx2")
+	void ForcesAVX2(const Arrays& arr, unsigned int begin, unsigned int end)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 sign = _mm256_set1_ps(-0.0f);
+
+		unsigned int i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(arr.x + i);
+			__m256 y = _mm256_loadu_ps(arr.y + i);
+			__m256 z = _mm256_loadu_ps(arr.z + i);
+			__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)));
+
+			__m256 stretch = _mm256_sub_ps(length, _mm256_loadu_ps(arr.restLength + i));
+			__m256 compressed = _mm256_mul_ps(_mm256_xor_ps(stretch, sign), _mm256_loadu_ps(arr.absolute + i));
+			__m256 amount = _mm256_max_ps(stretch, compressed);
+
+			__m256 tension = _mm256_xor_ps(_mm256_mul_ps(_mm256_loadu_ps(arr.stiffness + i), amount), sign);
+			__m256 scale = _mm256_and_ps(_mm256_div_ps(tension, length), _mm256_cmp_ps(length, zero, _CMP_GT_OQ));
+			_mm256_storeu_ps(arr.x + i, _mm256_mul_ps(x, scale));
+			_mm256_storeu_ps(arr.y + i, _mm256_mul_ps(y, scale));
+			_mm256_storeu_ps(arr.z + i, _mm256_mul_ps(z, scale));
+		}
+
+		ForcesSSE(arr, i, end);
+	}
+#endif
+}
+
+SpringSet::SpringSet() : kernel(ParticleIntegrator::BestAvailable())
+{
+}
+
+unsigned int SpringSet::Add(PhysicsParticle* firstParticle, PhysicsParticle* secondParticle, float stiffness,
+                            float restLength, bool stretchOnly)
+{
+	first.push_back(firstParticle);
+	second.push_back(secondParticle);
+	anchors.push_back(MyVector(0, 0, 0));
+	stiffnesses.push_back(stiffness);
+	restLengths.push_back(restLength);
+	absolute.push_back(stretchOnly ? 0.0f : 1.0f);
+	dirty = true;
+	version++;
+	return Size() - 1;
+}
+
+unsigned int SpringSet::AddAnchored(PhysicsParticle* particle, const MyVector& anchor, float stiffness,
+                                    float restLength, bool stretchOnly)
+{
+	unsigned int spring = Add(particle, nullptr, stiffness, restLength, stretchOnly);
+	anchors[spring] = anchor;
+	return spring;
+}
+
+void SpringSet::Clear()
+{
+	first.clear();
+	second.clear();
+	anchors.clear();
+	stiffnesses.clear();
+	restLengths.clear();
+	absolute.clear();
+	dirty = true;
+	version++;
+}
+
+void SpringSet::GetSpring(unsigned int spring, ForceGenerator::Spring& out) const
+{
+	out.other = second[spring];
+	out.anchor = anchors[spring];
+	out.stiffness = stiffnesses[spring];
+	out.restLength = restLengths[spring];
+	out.law = absolute[spring] != 0.0f ? ForceGenerator::Spring::Absolute : ForceGenerator::Spring::StretchOnly;
+}
+
+void SpringSet::SetKernel(ParticleIntegrator::Kernel toUse)
+{
+	ParticleIntegrator::Kernel best = ParticleIntegrator::BestAvailable();
+	kernel = toUse <= best ? toUse : best;
+}
+
+void SpringSet::Rebuild(const ParticleStore& store)
+{
+	auto indexOf = [&store](const PhysicsParticle* p)
+	{
+		return p && p->GetStore() == &store ? store.IndexOf(p->GetHandle()) : NoIndex;
+	};
+	auto awake = [&store](unsigned int index) { return index != NoIndex && !store.Asleep[index]; };
+
+	active.clear();
+	firstIndex.clear();
+	secondIndex.clear();
+	activeStiffness.clear();
+	activeRestLength.clear();
+	activeAbsolute.clear();
+	for (unsigned int spring = 0; spring < Size(); spring++)
+	{
+		unsigned int a = indexOf(first[spring]);
+		unsigned int b = indexOf(second[spring]);
+		if (!awake(a) && !awake(b)) continue;
+
+		active.push_back(spring);
+		firstIndex.push_back(a);
+		secondIndex.push_back(b);
+		activeStiffness.push_back(stiffnesses[spring]);
+		activeRestLength.push_back(restLengths[spring]);
+		activeAbsolute.push_back(absolute[spring]);
+	}
+
+	const unsigned int count = static_cast<unsigned int>(active.size());
+	forceX.resize(count);
+	forceY.resize(count);
+	forceZ.resize(count);
+
+	// Count the pushes per awake particle, then list them in spring order
+	std::vector<unsigned int> slotOf(store.Size(), NoIndex);
+	pushed.clear();
+	incidentStart.assign(1, 0);
+	for (unsigned int s = 0; s < count; s++)
+	{
+		for (unsigned int index : { firstIndex[s], secondIndex[s] })
+		{
+			if (!awake(index)) continue;
+			if (slotOf[index] == NoIndex)
+			{
+				slotOf[index] = static_cast<unsigned int>(pushed.size());
+				pushed.push_back(index);
+				incidentStart.push_back(0);
+			}
+			incidentStart[slotOf[index] + 1]++;
+		}
+	}
+	for (unsigned int slot = 0; slot < pushed.size(); slot++) incidentStart[slot + 1] += incidentStart[slot];
+
+	std::vector<unsigned int> filled(incidentStart.begin(), incidentStart.end() - 1);
+	incident.resize(incidentStart.back());
+	for (unsigned int s = 0; s < count; s++)
+	{
+		if (awake(firstIndex[s])) incident[filled[slotOf[firstIndex[s]]]++] = 2 * s;
+		if (awake(secondIndex[s])) incident[filled[slotOf[secondIndex[s]]]++] = 2 * s + 1;
+	}
+
+	dirty = false;
+	builtFor = &store;
+	builtLayout = store.LayoutVersion();
+}
+
+void SpringSet::UpdateForces(ParticleStore& store, WorkerPool* workers)
+{
+	if (dirty || builtFor != &store || builtLayout != store.LayoutVersion()) Rebuild(store);
+
+	const unsigned int count = static_cast<unsigned int>(active.size());
+	if (count == 0) return;
+
+	Arrays arr;
+	arr.x = forceX.data();
+	arr.y = forceY.data();
+	arr.z = forceZ.data();
+	arr.stiffness = activeStiffness.data();
+	arr.restLength = activeRestLength.data();
+	arr.absolute = activeAbsolute.data();
+
+	// Gather each spring's offset, then let the kernel turn it into a force in place
+	const ParticleIntegrator::Kernel selected = kernel;
+	auto computeForces = [this, &store, &arr, selected](unsigned int begin, unsigned int end)
+	{
+		const MyVector* positions = store.Positions.data();
+		for (unsigned int s = begin; s < end; s++)
+		{
+			const unsigned int spring = active[s];
+			const MyVector& a = firstIndex[s] != NoIndex ? positions[firstIndex[s]] : first[spring]->Position();
+			const MyVector& b = secondIndex[s] != NoIndex ? positions[secondIndex[s]]
+				                    : second[spring] ? second[spring]->Position() : anchors[spring];
+			forceX[s] = a.x - b.x;
+			forceY[s] = a.y - b.y;
+			forceZ[s] = a.z - b.z;
+		}
+
+		switch (selected)
+		{
+#if PHYSICS_SIMD
+		case ParticleIntegrator::AVX2:
+			ForcesAVX2(arr, begin, end);
+			break;
+		case ParticleIntegrator::SSE:
+			ForcesSSE(arr, begin, end);
+			break;
+#endif
+		default:
+			ForcesScalar(arr, begin, end);
+			break;
+		}
+	};
+
+	// Each particle sums its springs in order: the first particle gains the force, the
+	// second loses it
+	auto pushParticles = [this, &store](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int slot = begin; slot < end; slot++)
+		{
+			float x = 0, y = 0, z = 0;
+			for (unsigned int k = incidentStart[slot]; k < incidentStart[slot + 1]; k++)
+			{
+				const unsigned int s = incident[k] >> 1;
+				if (incident[k] & 1)
+				{
+					x -= forceX[s];
+					y -= forceY[s];
+					z -= forceZ[s];
+				}
+				else
+				{
+					x += forceX[s];
+					y += forceY[s];
+					z += forceZ[s];
+				}
+			}
+
+			MyVector& force = store.AccumulatedForces[pushed[slot]];
+			force.x += x;
+			force.y += y;
+			force.z += z;
+		}
+	};
+
+	const unsigned int pushedCount = static_cast<unsigned int>(pushed.size());
+	if (workers)
+	{
+		workers->ParallelFor(count, Chunk, computeForces);
+		workers->ParallelFor(pushedCount, Chunk, pushParticles);
+	}
+	else
+	{
+		computeForces(0, count);
+		pushParticles(0, pushedCount);
+	}
+}
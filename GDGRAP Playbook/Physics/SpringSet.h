@@ -0,0 +1,83 @@
+#pragma once
+#include <vector>
+
+#include "ForceGenerator.h"
+#include "ParticleIntegrator.h"
+#include "ParticleStore.h"
+
+class PhysicsParticle;
+class WorkerPool;
+
+// Many springs stored as contiguous arrays and evaluated together (PhysicsWorld::SpringSets).
+// Unlike ParticleSpring, a spring between two particles is computed once and pushes both
+// of them, with equal and opposite forces; anchored springs replace one AnchoredSpring or
+// Bungee object per particle. The force laws are those of the generators: a spring pulls
+// with its stiffness times how far its length is from its rest length, or, when stretch
+// only (Bungee), only while it is stretched past its rest length.
+//
+// Forces are computed 4 (SSE) or 8 (AVX2) springs at a time, then summed per particle in
+// the order the springs were added, so the result is the same for any kernel and any
+// number of worker threads.
+class SpringSet
+{
+public:
+	SpringSet();
+
+	// A spring between two particles; returns its index
+	unsigned int Add(PhysicsParticle* first, PhysicsParticle* second, float stiffness, float restLength,
+	                 bool stretchOnly = false);
+	// A spring from a particle to a fixed point; returns its index
+	unsigned int AddAnchored(PhysicsParticle* particle, const MyVector& anchor, float stiffness, float restLength,
+	                         bool stretchOnly = false);
+	void Clear();
+
+	unsigned int Size() const { return static_cast<unsigned int>(stiffnesses.size()); }
+	// Bumped by Add and Clear
+	unsigned int Version() const { return version; }
+	// end 0 or 1; end 1 is nullptr for anchored springs
+	PhysicsParticle* GetParticle(unsigned int spring, unsigned int end) const { return end == 0 ? first[spring] : second[spring]; }
+	// The spring as seen from its first particle
+	void GetSpring(unsigned int spring, ForceGenerator::Spring& out) const;
+
+	ParticleIntegrator::Kernel GetKernel() const { return kernel; }
+	// Falls back to the best available kernel if the requested one is unsupported
+	void SetKernel(ParticleIntegrator::Kernel toUse);
+
+	// Adds every spring's force to the awake particles of store. Springs whose particles are
+	// all asleep or outside store are skipped.
+	void UpdateForces(ParticleStore& store, WorkerPool* workers = nullptr);
+
+private:
+	// Dense index tables, rebuilt after Add/Clear or when particles move
+	void Rebuild(const ParticleStore& store);
+
+	static constexpr unsigned int NoIndex = ~0u;
+
+	ParticleIntegrator::Kernel kernel;
+
+	std::vector<PhysicsParticle*> first;
+	std::vector<PhysicsParticle*> second;
+	std::vector<MyVector> anchors;
+	std::vector<float> stiffnesses;
+	std::vector<float> restLengths;
+	std::vector<float> absolute; // 1 for springs that also push while compressed, 0 for stretch only
+
+	bool dirty = true;
+	unsigned int version = 0;
+	const ParticleStore* builtFor = nullptr;
+	unsigned int builtLayout = 0;
+
+	// Per active spring: dense indices of its particles (NoIndex for an anchor or a particle
+	// of another store) and its parameters, packed for the kernels
+	std::vector<unsigned int> active;
+	std::vector<unsigned int> firstIndex, secondIndex;
+	std::vector<float> activeStiffness, activeRestLength, activeAbsolute;
+	// The force on each active spring's first particle, split by axis
+	std::vector<float> forceX, forceY, forceZ;
+
+	// Dense indices of the awake particles the springs push, and for each the run of
+	// incident[] entries (active spring * 2 + end) that push it
+	std::vector<unsigned int> pushed;
+	std::vector<unsigned int> incidentStart;
+	std::vector<unsigned int> incident;
+};
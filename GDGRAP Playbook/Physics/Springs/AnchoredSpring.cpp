@@ -2,19 +2,26 @@
 
 #include <cmath>
 
+bool AnchoredSpring::GetSpring(Spring& spring) const
+{
+	spring.other = nullptr;
+	spring.anchor = anchorPoint;
+	spring.stiffness = springConstant;
+	spring.restLength = restLength;
+	spring.law = Spring::Absolute;
+	return true;
+}
+
 void AnchoredSpring::UpdateForce(PhysicsParticle* particle, float time)
 {
-	MyVector pos = particle->Position;
+	MyVector pos = particle->Position();
 
 	MyVector force = pos - anchorPoint;
 
-	float mag = force.magnitude();
-
-	float springForce = -springConstant * abs(mag - restLength);
-
-	force = force.normalize();
+	MyVector direction;
+	float mag = force.MagnitudeAndDirection(direction);
 
-	force = force * springForce;
+	float springForce = -springConstant * std::fabs(mag - restLength);
 
-	particle->AddForce(force);
+	particle->AddForce(direction * springForce);
 }
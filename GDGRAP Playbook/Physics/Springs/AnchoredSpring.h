@@ -15,4 +15,5 @@ public:
 	}
 
 	void UpdateForce(PhysicsParticle* particle, float time) override;
+	bool GetSpring(Spring& spring) const override;
 };
@@ -19,10 +19,20 @@ Bungee::Bungee(const MyVector& anchor, float springConstant, float restLength)
 {
 }
 
+bool Bungee::GetSpring(Spring& spring) const
+{
+	spring.other = nullptr;
+	spring.anchor = anchor;
+	spring.stiffness = springConstant;
+	spring.restLength = restLength;
+	spring.law = Spring::StretchOnly;
+	return true;
+}
+
 void Bungee::UpdateForce(PhysicsParticle* particle, float /*time*/)
 {
 	// Calculate vector from anchor to particle
-	MyVector force = particle->Position - anchor;
+	MyVector force = particle->Position() - anchor;
 	float length = force.magnitude();
 
 	// Only apply force if stretched beyond rest length
@@ -33,7 +43,7 @@ void Bungee::UpdateForce(PhysicsParticle* particle, float /*time*/)
 	float magnitude = -springConstant * extension;
 
 	// Normalize direction and scale by magnitude
-	force = force.normalize() * magnitude;
+	force = force.Direction(length) * magnitude;
 
 	// Apply the force to the particle
 	particle->AddForce(force);
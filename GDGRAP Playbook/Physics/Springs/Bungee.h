@@ -15,4 +15,5 @@ public:
 
 	// Applies the bungee force to the given particle
 	void UpdateForce(PhysicsParticle* particle, float time) override;
+	bool GetSpring(Spring& spring) const override;
 };
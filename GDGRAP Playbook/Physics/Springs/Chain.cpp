@@ -19,22 +19,23 @@ Chain::Chain(PhysicsParticle* particle, const MyVector& anchor, float maxLength,
 {
 }
 
-ParticleContact* Chain::GetContact()
+ParticleContact* Chain::GetContact(ContactArena& contacts)
 {
 	// Calculate the vector from anchor to particle
-	MyVector toParticle = particle->Position - anchor;
-	float length = toParticle.Magnitude();
+	MyVector toParticle = particle->Position() - anchor;
+	MyVector direction;
+	float length = toParticle.MagnitudeAndDirection(direction);
 
 	// If within max length, no contact needed
 	if (length <= maxLength) return nullptr;
 
 	// Otherwise, create a contact
-	auto contact = new ParticleContact();
+	ParticleContact* contact = contacts.Allocate();
 	contact->particles[0] = particle;
 	contact->particles[1] = nullptr; // Anchor is fixed
 
 	// The contact normal is from particle to anchor (direction to push particle back)
-	contact->contactNormal = toParticle.normalize() * -1.0f;
+	contact->contactNormal = direction * -1.0f;
 
 	// Penetration depth is how much the chain is overstretched
 	contact->depth = length - maxLength;
@@ -44,3 +45,30 @@ ParticleContact* Chain::GetContact()
 
 	return contact;
 }
+
+void Chain::Project(float time)
+{
+	MyVector toParticle = particle->Position() - anchor;
+	float length = toParticle.Magnitude();
+	if (length <= maxLength || particle->GetInverseMass() <= 0.0f) return;
+
+	particle->Position() = anchor + toParticle * (maxLength / length);
+}
+
+void Chain::Save(SnapshotWriter& out) const
+{
+	ParticleLink::Save(out);
+	out.WritePointer(particle);
+	out.Write(anchor);
+	out.Write(maxLength);
+	out.Write(restitution);
+}
+
+void Chain::Load(SnapshotReader& in)
+{
+	ParticleLink::Load(in);
+	in.ReadPointer(particle);
+	in.Read(anchor);
+	in.Read(maxLength);
+	in.Read(restitution);
+}
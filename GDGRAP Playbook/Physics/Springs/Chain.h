@@ -2,7 +2,7 @@
 #include "../PhysicsParticle.h"
 #include "../ParticleContact.h"
 #include "../MyVector.h"
-#include "../../ParticleLink.h"
+#include "../ParticleLink.h"
 
 class Chain : public ParticleLink
 {
@@ -14,5 +14,11 @@ public:
 
 	Chain(PhysicsParticle* particle, const MyVector& anchor, float maxLength, float restitution);
 
-	ParticleContact* GetContact() override;
+	ParticleContact* GetContact(ContactArena& contacts) override;
+	// Position-based: pulls the particle back onto the sphere of maxLength around the anchor
+	bool CanProject() const override { return true; }
+	void Project(float time) override;
+	bool IsAsleep() const override { return particle->IsAsleep(); }
+	void Save(SnapshotWriter& out) const override;
+	void Load(SnapshotReader& in) override;
 };
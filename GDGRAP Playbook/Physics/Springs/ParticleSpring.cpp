@@ -2,19 +2,25 @@
 
 #include <cmath>
 
-void ParticleSpring::UpdateForce(PhysicsParticle* particle, float time)
+bool ParticleSpring::GetSpring(Spring& spring) const
 {
-	MyVector pos = particle->Position;
-
-	MyVector force = pos - otherParticle->Position;
+	spring.other = otherParticle;
+	spring.stiffness = springConstant;
+	spring.restLength = restLength;
+	spring.law = Spring::Absolute;
+	return true;
+}
 
-	float mag = force.magnitude();
+void ParticleSpring::UpdateForce(PhysicsParticle* particle, float time)
+{
+	MyVector pos = particle->Position();
 
-	float springForce = -springConstant * abs(mag - restLength);
+	MyVector force = pos - otherParticle->Position();
 
-	force = force.normalize();
+	MyVector direction;
+	float mag = force.MagnitudeAndDirection(direction);
 
-	force = force * springForce;
+	float springForce = -springConstant * std::fabs(mag - restLength);
 
-	particle->AddForce(force);
+	particle->AddForce(direction * springForce);
 }
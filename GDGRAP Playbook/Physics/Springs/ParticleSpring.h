@@ -11,4 +11,6 @@
 	public:
 		ParticleSpring(PhysicsParticle* otherParticle, float springConstant, float restLength) : otherParticle(otherParticle), springConstant(springConstant), restLength(restLength) {}
 		void UpdateForce(PhysicsParticle* particle, float time) override;
+		PhysicsParticle* GetConnectedParticle() const override { return otherParticle; }
+		bool GetSpring(Spring& spring) const override;
 	};	
@@ -0,0 +1,210 @@
+#include "WorkerPool.h"
+
+namespace
+{
+	// Lets a worker find its own queue
+	thread_local const WorkerPool* currentPool = nullptr;
+	thread_local unsigned int currentWorker = 0;
+
+	// Empty rounds Wait yields through before it sleeps
+	const unsigned int SpinRounds = 64;
+}
+
+WorkerPool::WorkerPool(unsigned int threadCount)
+{
+	SetThreadCount(threadCount);
+}
+
+WorkerPool::~WorkerPool()
+{
+	SetThreadCount(0);
+}
+
+void WorkerPool::SetThreadCount(unsigned int threadCount)
+{
+	if (threadCount == workers.size() && !queues.empty()) return;
+
+	// Workers only leave once every queue is empty
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers) worker.join();
+	workers.clear();
+
+	stopping = false;
+	queues.clear();
+	for (unsigned int i = 0; i <= threadCount; i++) queues.emplace_back(new Queue());
+	for (unsigned int i = 0; i < threadCount; i++) workers.emplace_back(&WorkerPool::WorkerLoop, this, i);
+}
+
+void WorkerPool::Submit(Job job, JobCounter& counter)
+{
+	if (workers.empty())
+	{
+		job();
+		return;
+	}
+
+	Task task;
+	task.job = std::move(job);
+	task.counter = &counter;
+	counter.pending.fetch_add(1, std::memory_order_relaxed);
+	Push(std::move(task));
+}
+
+void WorkerPool::Wait(JobCounter& counter)
+{
+	unsigned int idleRounds = 0;
+	while (!counter.Done())
+	{
+		Task task;
+		if (Pop(task) || Steal(task))
+		{
+			Run(task);
+			idleRounds = 0;
+		}
+		else if (++idleRounds < SpinRounds) std::this_thread::yield(); // The rest is running elsewhere
+		else
+		{
+			// Long jobs: sleep until the last one finishes or there is work to help with
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			blockedWaiters++;
+			wake.wait(lock, [this, &counter] { return counter.Done() || queued.load(std::memory_order_acquire) > 0; });
+			blockedWaiters--;
+			idleRounds = 0;
+		}
+	}
+}
+
+void WorkerPool::ParallelFor(unsigned int count, unsigned int grain, const RangeFunction& body)
+{
+	if (count == 0) return;
+	if (grain == 0) grain = 1;
+
+	if (workers.empty() || count <= grain)
+	{
+		body(0, count);
+		return;
+	}
+
+	JobCounter counter;
+	counter.pending.store(1, std::memory_order_relaxed);
+
+	Task task;
+	task.range = &body;
+	task.end = count;
+	task.grain = grain;
+	task.counter = &counter;
+	Run(task);
+	Wait(counter);
+}
+
+WorkerPool::Queue& WorkerPool::LocalQueue()
+{
+	return currentPool == this ? *queues[currentWorker] : *queues.back();
+}
+
+void WorkerPool::Push(Task task)
+{
+	Queue& queue = LocalQueue();
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+		queued.fetch_add(1, std::memory_order_release);
+	}
+
+	// Taking the lock orders this against a thread checking queued before it sleeps.
+	// Threads sleeping in Wait share the condition with the workers, so wake them all.
+	bool waitersBlocked;
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		waitersBlocked = blockedWaiters > 0;
+	}
+	if (waitersBlocked) wake.notify_all();
+	else wake.notify_one();
+}
+
+bool WorkerPool::Pop(Task& task)
+{
+	Queue& queue = LocalQueue();
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty()) return false;
+
+	task = std::move(queue.tasks.back());
+	queue.tasks.pop_back();
+	queued.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+bool WorkerPool::Steal(Task& task)
+{
+	const unsigned int count = static_cast<unsigned int>(queues.size());
+	const unsigned int start = currentPool == this ? currentWorker + 1 : 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		Queue& queue = *queues[(start + i) % count];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty()) continue;
+
+		task = std::move(queue.tasks.front());
+		queue.tasks.pop_front();
+		queued.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+void WorkerPool::Run(Task& task)
+{
+	if (task.range)
+	{
+		// Leave the far half for others to steal and keep splitting the near one
+		while (task.end - task.begin > task.grain)
+		{
+			Task half;
+			half.range = task.range;
+			half.begin = task.begin + (task.end - task.begin) / 2;
+			half.end = task.end;
+			half.grain = task.grain;
+			half.counter = task.counter;
+			task.counter->pending.fetch_add(1, std::memory_order_relaxed);
+			task.end = half.begin;
+			Push(std::move(half));
+		}
+		(*task.range)(task.begin, task.end);
+	}
+	else task.job();
+
+	if (task.counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		// Last job of its fork: the thread waiting on it may be asleep
+		bool waitersBlocked;
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			waitersBlocked = blockedWaiters > 0;
+		}
+		if (waitersBlocked) wake.notify_all();
+	}
+}
+
+void WorkerPool::WorkerLoop(unsigned int index)
+{
+	currentPool = this;
+	currentWorker = index;
+
+	while (true)
+	{
+		Task task;
+		if (Pop(task) || Steal(task))
+		{
+			Run(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wake.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+		if (stopping && queued.load(std::memory_order_acquire) == 0) return;
+	}
+}
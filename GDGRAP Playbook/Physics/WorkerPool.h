@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counts the jobs of a fork that have not finished yet; WorkerPool::Wait joins on it.
+// Must outlive every job submitted with it.
+class JobCounter
+{
+public:
+	bool Done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class WorkerPool;
+	std::atomic<unsigned int> pending{ 0 };
+};
+
+// Work-stealing job system: a fixed set of worker threads, each with its own deque of
+// jobs. A thread pushes and pops jobs at the back of its own deque, and when that is empty
+// steals from the front of another's, so the oldest (and for ParallelFor, largest) pieces
+// of work are the ones that move between threads. Threads that are not workers, such as
+// the one stepping the world, submit to a shared deque and run jobs while they wait.
+// With no threads (the default) every job runs inline on the calling thread, which keeps
+// the order of everything deterministic for debugging.
+class WorkerPool
+{
+public:
+	typedef std::function<void()> Job;
+	typedef std::function<void(unsigned int begin, unsigned int end)> RangeFunction;
+
+	explicit WorkerPool(unsigned int threadCount = 0);
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+	~WorkerPool();
+
+	// Waits for submitted jobs before replacing the workers
+	void SetThreadCount(unsigned int threadCount);
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(workers.size()); }
+
+	// Fork: queues job, counting it on counter until it has run
+	void Submit(Job job, JobCounter& counter);
+	// Join: returns once every job counted on counter has run, running queued jobs meanwhile.
+	// With nothing left to run it yields for a while, then sleeps until the jobs finish.
+	void Wait(JobCounter& counter);
+
+	// Calls body on chunks of at most grain indices covering [0, count) and returns once
+	// every chunk is done. Ranges are split in halves, so idle threads steal big halves
+	// first and split them further themselves.
+	void ParallelFor(unsigned int count, unsigned int grain, const RangeFunction& body);
+
+private:
+	struct Task
+	{
+		Job job; // Empty for a range of a ParallelFor
+		const RangeFunction* range = nullptr;
+		unsigned int begin = 0, end = 0, grain = 1;
+		JobCounter* counter = nullptr;
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	// The queue the calling thread owns: its worker queue, or the shared one
+	Queue& LocalQueue();
+	void Push(Task task);
+	bool Pop(Task& task);
+	bool Steal(Task& task);
+	void Run(Task& task);
+	void WorkerLoop(unsigned int index);
+
+	std::vector<std::thread> workers;
+	// One per worker, then the shared queue of every other thread
+	std::vector<std::unique_ptr<Queue>> queues;
+
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<unsigned int> queued{ 0 };
+	unsigned int blockedWaiters = 0; // Threads asleep in Wait, guarded by sleepMutex
+	bool stopping = false;
+};
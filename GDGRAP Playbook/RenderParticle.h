@@ -1,5 +1,6 @@
 #pragma once
 #include "Model.h"
+#include "ParticleRenderer.h"
 #include "Physics/PhysicsParticle.h"
 
 class RenderParticle
@@ -14,7 +15,8 @@ public:
 	{
 	}
 
-	void Draw(GLuint shaderProgram, const glm::mat4& transformation_matrix);
-	void DrawLink(const glm::vec3& a, const glm::vec3& b, GLuint shaderProgram, const glm::mat4& mvp);
+	void Draw(ShaderProgram& shader, const glm::mat4& transformation_matrix);
+	// Queues the particle on renderer instead of drawing it right away
+	void Draw(ParticleRenderer& renderer, const glm::mat4& transformation_matrix);
 
 };
@@ -0,0 +1,180 @@
+#include "ShaderProgram.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <glm/gtc/type_ptr.hpp>
+
+GLuint ShaderProgram::current = 0;
+
+namespace
+{
+	const char* const BuiltinNames[ShaderProgram::BuiltinCount] = { "MVP", "uColor", "uInstanced", "uVertexColor" };
+}
+
+ShaderProgram::~ShaderProgram()
+{
+	if (!id) return;
+
+	if (current == id) current = 0;
+	glDeleteProgram(id);
+}
+
+GLuint ShaderProgram::Compile(GLenum stage, const std::string& path, std::string& error)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		error = "Cannot open shader " + path;
+		return 0;
+	}
+	std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	const char* text = source.c_str();
+
+	GLuint shader = glCreateShader(stage);
+	glShaderSource(shader, 1, &text, nullptr);
+	glCompileShader(shader);
+
+	GLint compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (!compiled)
+	{
+		GLint length = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+		std::string log(length > 0 ? length : 1, '\0');
+		glGetShaderInfoLog(shader, static_cast<GLsizei>(log.size()), nullptr, &log[0]);
+
+		error = path + ": " + log.c_str();
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+bool ShaderProgram::Load(const std::string& vertexPath, const std::string& fragmentPath, std::string& error)
+{
+	GLuint vertex = Compile(GL_VERTEX_SHADER, vertexPath, error);
+	if (!vertex) return false;
+
+	GLuint fragment = Compile(GL_FRAGMENT_SHADER, fragmentPath, error);
+	if (!fragment)
+	{
+		glDeleteShader(vertex);
+		return false;
+	}
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertex);
+	glAttachShader(program, fragment);
+	glLinkProgram(program);
+
+	// The program keeps what it needs; the stages can go either way
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		GLint length = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+		std::string log(length > 0 ? length : 1, '\0');
+		glGetProgramInfoLog(program, static_cast<GLsizei>(log.size()), nullptr, &log[0]);
+
+		error = "Linking " + vertexPath + " and " + fragmentPath + ": " + log.c_str();
+		glDeleteProgram(program);
+		return false;
+	}
+
+	if (id)
+	{
+		if (current == id) current = 0;
+		glDeleteProgram(id);
+	}
+	id = program;
+
+	// Cache every active uniform's location
+	locations.clear();
+	GLint count = 0, maxNameLength = 0;
+	glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::string name(maxNameLength > 0 ? maxNameLength : 1, '\0');
+	GLint maxLocation = -1;
+	for (GLint i = 0; i < count; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(id, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &length, &size, &type, &name[0]);
+
+		std::string uniform(name.c_str(), length);
+		GLint location = glGetUniformLocation(id, uniform.c_str());
+		if (location < 0) continue; // Uniform block members have no location
+
+		locations[uniform] = location;
+		// Arrays are reported as "name[0]"; accept the bare name as well
+		if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0)
+			locations[uniform.substr(0, uniform.size() - 3)] = location;
+
+		if (location > maxLocation) maxLocation = location;
+	}
+
+	for (int b = 0; b < BuiltinCount; b++)
+		builtins[b] = Uniform(BuiltinNames[b]);
+
+	values.assign(static_cast<size_t>(maxLocation + 1), CachedValue());
+	return true;
+}
+
+void ShaderProgram::Use()
+{
+	if (current == id) return;
+
+	glUseProgram(id);
+	current = id;
+}
+
+GLint ShaderProgram::Uniform(const std::string& name) const
+{
+	auto found = locations.find(name);
+	return found != locations.end() ? found->second : -1;
+}
+
+bool ShaderProgram::Changed(GLint location, const void* value, unsigned int size)
+{
+	// Locations past the cached range (array elements) are always uploaded
+	if (static_cast<size_t>(location) >= values.size()) return true;
+
+	CachedValue& cached = values[location];
+	if (cached.size == size && std::memcmp(cached.bytes, value, size) == 0) return false;
+
+	cached.size = size;
+	std::memcpy(cached.bytes, value, size);
+	return true;
+}
+
+void ShaderProgram::Set(GLint location, int value)
+{
+	if (location < 0 || !Changed(location, &value, sizeof(value))) return;
+
+	Use();
+	glUniform1i(location, value);
+}
+
+void ShaderProgram::Set(GLint location, const glm::vec3& value)
+{
+	if (location < 0 || !Changed(location, glm::value_ptr(value), sizeof(value))) return;
+
+	Use();
+	glUniform3fv(location, 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::Set(GLint location, const glm::mat4& value)
+{
+	if (location < 0 || !Changed(location, glm::value_ptr(value), sizeof(value))) return;
+
+	Use();
+	glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
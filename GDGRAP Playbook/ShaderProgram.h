@@ -0,0 +1,68 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// A linked vertex + fragment program.
+// Uniform locations are looked up once at link time, and the program remembers the last
+// value uploaded to each uniform so repeated Set calls and repeated Use calls cost no GL
+// calls. All binding of programs should go through Use for the tracking to hold.
+class ShaderProgram
+{
+public:
+	// Uniforms the engine's draw paths set, resolved at link time so drawing needs no names
+	enum Builtin
+	{
+		MVP, // mat4
+		Color, // vec3 uColor
+		Instanced, // bool uInstanced
+		VertexColor, // bool uVertexColor
+		BuiltinCount
+	};
+
+	ShaderProgram() = default;
+	ShaderProgram(const ShaderProgram&) = delete;
+	ShaderProgram& operator=(const ShaderProgram&) = delete;
+	~ShaderProgram();
+
+	// Compiles and links the two stages. On failure error holds the file name and the
+	// compiler or linker log, and any previously loaded program is kept.
+	bool Load(const std::string& vertexPath, const std::string& fragmentPath, std::string& error);
+
+	GLuint Id() const { return id; }
+
+	// Binds the program unless it is already the current one
+	void Use();
+
+	// -1 for uniforms the program does not have (or the compiler removed)
+	GLint Uniform(Builtin uniform) const { return builtins[uniform]; }
+	GLint Uniform(const std::string& name) const;
+
+	// Bind the program and upload the value, unless the uniform already holds it.
+	// Location -1 is ignored, as in glUniform*.
+	void Set(GLint location, int value);
+	void Set(GLint location, const glm::vec3& value);
+	void Set(GLint location, const glm::mat4& value);
+
+private:
+	static GLuint Compile(GLenum stage, const std::string& path, std::string& error);
+	// True when the cached value differs and was replaced
+	bool Changed(GLint location, const void* value, unsigned int size);
+
+	GLuint id = 0;
+	GLint builtins[BuiltinCount] = { -1, -1, -1, -1 };
+	std::unordered_map<std::string, GLint> locations;
+
+	// Last uploaded value of each uniform, by location
+	struct CachedValue
+	{
+		unsigned int size = 0; // 0 until the first upload
+		unsigned char bytes[sizeof(glm::mat4)];
+	};
+	std::vector<CachedValue> values;
+
+	static GLuint current; // Program bound through Use
+};
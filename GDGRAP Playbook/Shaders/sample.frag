@@ -1,9 +1,9 @@
 #version 330 core
 
-uniform vec3 uColor;
+in vec3 vColor;
 out vec4 FragColor;
 
 void main()
 {
-    FragColor = vec4(uColor, 1.0);
+    FragColor = vec4(vColor, 1.0);
 }
@@ -2,9 +2,28 @@
 
 layout(location = 0) in vec3 aPos;
 
-uniform mat4 MVP;
+// Per-instance data, read when uInstanced is set (see ParticleRenderer)
+layout(location = 1) in mat4 aTransform;
+// Per-instance color, or per-vertex color when uVertexColor is set (see LineBatch)
+layout(location = 5) in vec3 aColor;
+
+uniform mat4 MVP; // View-projection only when instanced
+uniform bool uInstanced;
+uniform bool uVertexColor;
+uniform vec3 uColor;
+
+out vec3 vColor;
 
 void main()
 {
-    gl_Position = MVP * vec4(aPos, 1.0);
+    if (uInstanced)
+    {
+        gl_Position = MVP * aTransform * vec4(aPos, 1.0);
+        vColor = aColor;
+    }
+    else
+    {
+        gl_Position = MVP * vec4(aPos, 1.0);
+        vColor = uVertexColor ? aColor : uColor;
+    }
 }
\ No newline at end of file
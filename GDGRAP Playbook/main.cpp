@@ -14,8 +14,11 @@
 
 #include "Model.h"
 #include "RenderParticle.h"
-#include "Rod.h"
-#include "ParticleLink.h"
+#include "ParticleRenderer.h"
+#include "LineBatch.h"
+#include "ShaderProgram.h"
+#include "Physics/Rod.h"
+#include "Physics/ParticleLink.h"
 
 #include "Physics/DragForceGenerator.h"
 #include "Physics/PhysicsParticle.h"
@@ -24,6 +27,7 @@
 #include "Physics/Springs/Chain.h"
 #include "Physics/ParticleContact.h"
 #include "Physics/ContactResolver.h"
+#include "Headless/Replay.h"
 
 using namespace std::chrono_literals;
 constexpr std::chrono::nanoseconds timestep(16ms);
@@ -89,17 +93,8 @@ MyVector accumulatedAcceleration(0.f, 0.f, 0.f);
 
 // Newton's Cradle setup
 const int NUM_BALLS = 5;
-std::vector<PhysicsParticle> cradleBalls;
 std::vector<MyVector> cradleAnchors;
 
-/*
-* ===========================================================
-* ========================= Drag ============================
-* ===========================================================
-*/
-auto drag = DragForceGenerator(0.0f, 0.0f);
-auto gravity = GravityForceGenerator(MyVector(0.0f, -9.8f, 0.0f)); // make use of gravity in GravityForceGenerator
-
 // Particle spawn timing
 constexpr float spawnInterval = 1.0f; 
 float timeSinceLastSpawn = 0.0f;
@@ -134,8 +129,11 @@ void KeyCallback(GLFWwindow* window, int key, int, int action, int)
 	if (key == GLFW_KEY_D) keyD = (action != GLFW_RELEASE);
 }
 
-int main()
+int main(int argc, char** argv)
 {
+	// Every session is recorded so it can be re-simulated with replay_runner
+	const std::string replayPath = argc > 1 ? argv[1] : "playbook.replay";
+
 	/*
 	* ===========================================================
 	* ======================== Setup ============================
@@ -159,26 +157,18 @@ int main()
 	glEnable(GL_DEPTH_TEST);
 
 	// Load shaders
-	std::ifstream vertSrc("Shaders/sample.vert"), fragSrc("Shaders/sample.frag");
-	std::string vertCode((std::istreambuf_iterator<char>(vertSrc)), std::istreambuf_iterator<char>());
-	std::string fragCode((std::istreambuf_iterator<char>(fragSrc)), std::istreambuf_iterator<char>());
-	const char* vert = vertCode.c_str();
-	const char* frag = fragCode.c_str();
-
-	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vert, nullptr);
-	glCompileShader(vertexShader);
-
-	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &frag, nullptr);
-	glCompileShader(fragmentShader);
-
-	GLuint shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vertexShader);
-	glAttachShader(shaderProgram, fragmentShader);
-	glLinkProgram(shaderProgram);
+	ShaderProgram shaderProgram;
+	std::string shaderError;
+	if (!shaderProgram.Load("Shaders/sample.vert", "Shaders/sample.frag", shaderError))
+	{
+		std::cerr << shaderError << "\n";
+		glfwTerminate();
+		return -1;
+	}
 
 	Model model("3D/sphere.obj");
+	ParticleRenderer particleRenderer;
+	LineBatch lineBatch;
 	auto identity_matrix = glm::mat4(1.0f);
 	modelPositions.emplace_back(glm::vec3(0.0f, 0.0f, 0.0f));
 
@@ -213,12 +203,7 @@ int main()
 	std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 
 	// Use user input for simulation parameters
-	const float CABLE_LENGTH = cableLength;
 	const float BALL_RADIUS = particleRadius;
-	const float PARTICLE_GAP = 2.0f * BALL_RADIUS;
-
-	// Update gravity with user input
-	gravity = GravityForceGenerator(MyVector(0.0f, gravityStrength, 0.0f));
 
 	/*
 	* ===========================================================
@@ -226,26 +211,43 @@ int main()
 	* ===========================================================
 	*/
 
-	cradleBalls.resize(NUM_BALLS);
-	float totalWidth = (NUM_BALLS - 1) * PARTICLE_GAP;
-	float startX = -totalWidth / 2.0f;
-
-	for (int i = 0; i < NUM_BALLS; ++i)
+	// Built by the same Scene code as the headless tools, so replays rebuild it exactly
+	SceneDescription cradle;
+	cradle.Type = "cradle";
+	cradle.Count = NUM_BALLS;
+	cradle.Radius = BALL_RADIUS;
+	cradle.Mass = 50.0f;
+	cradle.CableLength = cableLength;
+	cradle.Gravity = gravityStrength;
+	cradle.Force = MyVector(0, 0, 0); // The push comes from the space bar instead
+	cradle.Restitution = 0.9f; // Ball-to-ball collisions are found by the world's broadphase
+
+	Scene scene(cradle);
+	std::string sceneError;
+	if (!scene.Build(pWorld, sceneError))
 	{
-		float xPos = startX + i * PARTICLE_GAP;
-		float anchorY = 0.0f; 
-		MyVector anchorPosition(xPos, anchorY, 0);
+		std::cerr << sceneError << "\n";
+		glfwTerminate();
+		return -1;
+	}
 
-		cradleBalls[i].Position = anchorPosition; // Start at anchor
-		cradleBalls[i].Velocity = MyVector(0, 0, 0);
-		cradleBalls[i].mass = 50.0f;
-		cradleBalls[i].damping = 1.0f;
-		cradleAnchors.push_back(anchorPosition);
+	for (PhysicsParticle& ball : scene.Particles)
+		renderParticles.push_back(new RenderParticle(&ball, &model, MyVector(0.7f, 0.7f, 0.7f)));
+	for (const std::unique_ptr<ParticleLink>& link : scene.Links)
+	{
+		if (const Chain* chain = dynamic_cast<const Chain*>(link.get())) cradleAnchors.push_back(chain->anchor);
+	}
 
-		renderParticles.push_back(new RenderParticle(&cradleBalls[i], &model, MyVector(0.7f, 0.7f, 0.7f)));
+	ReplaySettings replaySettings;
+	replaySettings.FixedStep = pWorld.FixedStep;
+	replaySettings.MaxStepsPerFrame = pWorld.MaxStepsPerFrame;
+	replaySettings.Sleep = pWorld.Islands.Enabled;
 
-		pWorld.AddParticle(&cradleBalls[i]);
-	}
+	ReplayRecorder recorder;
+	if (recorder.Open(replayPath, cradle, replaySettings, sceneError))
+		std::cout << "Recording to " << replayPath << "\n";
+	else
+		std::cerr << sceneError << "\n";
 
 	/*
 	* ===========================================================
@@ -270,75 +272,10 @@ int main()
 
 			
 
-			// Apply gravity and drag to each ball
-			for (int i = 0; i < NUM_BALLS; ++i)
-			{
-				gravity.UpdateForce(&cradleBalls[i], deltaTime);
-				drag.UpdateForce(&cradleBalls[i], deltaTime);
-			}
-
-			const float fixedStep = 1.0f / 120.0f;
-			float timeToSimulate = deltaTime;
-			while (timeToSimulate > 0.0f) {
-				float step = std::min(fixedStep, timeToSimulate);
-				pWorld.Update(step);
-				timeToSimulate -= step;
-			}
-
-			// Enforce cable length constraint for each ball
-			for (size_t i = 0; i < cradleBalls.size(); ++i)
-			{
-				MyVector& pos = cradleBalls[i].Position;
-				const MyVector& anchor = cradleAnchors[i];
-				MyVector offset = pos - anchor;
-				float dist = offset.Magnitude();
-
-				if (dist > CABLE_LENGTH)
-				{
-					MyVector direction = offset.normalize();
-					pos = anchor + direction * CABLE_LENGTH;
-					MyVector& vel = cradleBalls[i].Velocity;
-					float velAlongCable = vel.ScalarProduct(direction);
-					if (velAlongCable > 0)
-						vel -= direction * velAlongCable;
-				}
-			}
-
-			 // Collision handling with multiple iterations
-			const int collisionIterations = 5;
-			for (int iter = 0; iter < collisionIterations; ++iter)
-			{
-				for (int i = 0; i < NUM_BALLS - 1; ++i)
-				{
-					float minDist = 2.0f * BALL_RADIUS;
-					MyVector delta = cradleBalls[i + 1].Position - cradleBalls[i].Position;
-					float dist = delta.Magnitude();
-					if (dist < minDist)
-					{
-						MyVector collisionNormal = delta.normalize();
-						float v1 = cradleBalls[i].Velocity.ScalarProduct(collisionNormal);
-						float v2 = cradleBalls[i + 1].Velocity.ScalarProduct(collisionNormal);
-
-						float restitution = 0.9f; 
-
-						// Only transfer if balls are moving towards each other
-						if (v1 > v2)
-						{
-							// Calculate new velocities (1D elastic collision, equal mass)
-							float v1After = v2;
-							float v2After = v1;
-
-							cradleBalls[i].Velocity += (v1After - v1) * collisionNormal * restitution;
-							cradleBalls[i + 1].Velocity += (v2After - v2) * collisionNormal * restitution;
-						}
-
-						// Separate the balls so they are not overlapping
-						float overlap = minDist - dist;
-						cradleBalls[i].Position -= collisionNormal * (overlap * 0.5f);
-						cradleBalls[i + 1].Position += collisionNormal * (overlap * 0.5f);
-					}
-				}
-			}
+			// Physics runs at its own fixed rate; rendering blends the last two steps.
+			// The balls' chains keep them on their cables.
+			pWorld.Advance(deltaTime);
+			recorder.RecordFrame(deltaTime, scene);
 		}
 		else
 		{
@@ -349,7 +286,9 @@ int main()
 		if (applyForceNextFrame && !forceApplied)
 		{
 			// Apply a leftward force to the leftmost particle
-			cradleBalls[0].AddForce(MyVector(-std::abs(forceX), forceY, forceZ));
+			MyVector push(-std::abs(forceX), forceY, forceZ);
+			scene.Particles[0].AddForce(push);
+			recorder.RecordForce(0, push);
 			forceApplied = true;
 			applyForceNextFrame = false;
 		}
@@ -380,6 +319,7 @@ int main()
 
 		glm::mat4 view = glm::lookAt(cameraPos, cameraTarget, cameraUp);
 
+		const float alpha = pWorld.InterpolationAlpha();
 		auto individualScale = particleScales.begin();
 		int ballIndex = 0;
 		for (auto i = renderParticles.begin(); i != renderParticles.end(); ++i)
@@ -391,35 +331,27 @@ int main()
 				++individualScale;
 			}
 			PhysicsParticle* particle = (*i)->particle;
-			glm::vec3 updatedPos(particle->Position.x, particle->Position.y, particle->Position.z);
+			MyVector position = particle->InterpolatedPosition(alpha);
+			glm::vec3 updatedPos(position.x, position.y, position.z);
 			glm::mat4 model = glm::translate(identity_matrix, updatedPos);
 			model = glm::rotate(model, glm::radians(thetha), glm::vec3(axis_x, axis_y, axis_z));
 			model = glm::scale(model, glm::vec3(scale, scale, scale));
 
 
-			glm::mat4 mvp = projection * view * model;
-			GLint mvpLoc = glGetUniformLocation(shaderProgram, "MVP");
-			glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, glm::value_ptr(mvp));
-
-			(*i)->Draw(shaderProgram, mvp);
-
-			glm::mat4 mvpLine = projection * view;
-			glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, glm::value_ptr(mvpLine));
+			// Balls and cables are drawn together by the Flush calls below
+			(*i)->Draw(particleRenderer, model);
 
 			// Draw the cable to the anchor
 			if (ballIndex < cradleAnchors.size())
 			{
 				MyVector anchorPos = cradleAnchors[ballIndex];
-				(*i)->DrawLink(
-					glm::vec3(particle->Position.x, particle->Position.y, particle->Position.z),
-					glm::vec3(anchorPos.x, anchorPos.y, anchorPos.z),
-					shaderProgram,
-					mvpLine
-				);
+				lineBatch.Add(updatedPos, glm::vec3(anchorPos.x, anchorPos.y, anchorPos.z), glm::vec3(1.0f, 0.0f, 0.0f));
 			}
 			ballIndex++;
 		}
 
+		particleRenderer.Flush(shaderProgram, projection * view);
+		lineBatch.Flush(shaderProgram, projection * view);
 		
 
 		glfwSwapBuffers(window);